@@ -0,0 +1,938 @@
+#ifndef FAKEALGORITHM_H
+#define FAKEALGORITHM_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+#include "fakeVector.h"
+#include "fakeSimd.h"
+#include "fakeThreadPool.h"
+
+namespace fake{
+	namespace detail{
+		/**
+		 * @brief      Checks whether searching a vector of T for a U can use the SIMD kernels: T must be a 32 or 64 bit
+		 * arithmetic type and U the same type, so the comparison is exactly T == T.
+		 */
+		template <class T, class U>
+		struct is_simd_searchable : std::integral_constant<bool,
+			simd::is_lane_type<T>::value && std::is_same<T, typename std::decay<U>::type>::value> {};
+
+		template <class T, class U>
+		inline std::size_t find_index(const T* data, std::size_t n, const U& value, std::true_type){
+			return simd::find(data, n, value);
+		}
+
+		template <class T, class U>
+		inline std::size_t find_index(const T* data, std::size_t n, const U& value, std::false_type){
+			return std::find(data, data + n, value) - data;
+		}
+
+		template <class T, class U>
+		inline std::size_t count_equal(const T* data, std::size_t n, const U& value, std::true_type){
+			return simd::count(data, n, value);
+		}
+
+		template <class T, class U>
+		inline std::size_t count_equal(const T* data, std::size_t n, const U& value, std::false_type){
+			return std::count(data, data + n, value);
+		}
+
+		template <class T, class Range>
+		inline std::size_t find_first_of_index(const T* data, std::size_t n, const Range& values, std::true_type){
+			using std::begin;
+			using std::end;
+			const fake::vector<T> needles(begin(values), end(values));
+			return simd::find_first_of(data, n, needles.data(), needles.size());
+		}
+
+		template <class T, class Range>
+		inline std::size_t find_first_of_index(const T* data, std::size_t n, const Range& values, std::false_type){
+			using std::begin;
+			using std::end;
+			return std::find_first_of(data, data + n, begin(values), end(values)) - data;
+		}
+
+		/**
+		 * @brief      Indices of the first smallest and the last largest element, like std::minmax_element.
+		 * Floating point arrays holding a NaN are handed to std::minmax_element.
+		 */
+		template <class T>
+		inline std::pair<std::size_t, std::size_t> minmax_index(const T* data, std::size_t n, std::false_type){
+			const std::pair<const T*, const T*> r = std::minmax_element(data, data + n);
+			return std::make_pair(r.first - data, r.second - data);
+		}
+
+		template <class T>
+		inline std::pair<std::size_t, std::size_t> minmax_index(const T* data, std::size_t n, std::true_type){
+			if (n == 0)
+				return std::make_pair(n, n);
+			const typename simd::detail::minmax_kernel<T>::result r = simd::minmax(data, n);
+			if (r.unordered)
+				return minmax_index(data, n, std::false_type());
+			return std::make_pair(simd::find(data, n, r.min), simd::find_last(data, n, r.max));
+		}
+
+		/**
+		 * @brief      Maps a sort key to an unsigned integer of the same size whose unsigned order is the key order.
+		 * Signed integers get their sign bit flipped, floats all their bits when negative and the sign bit otherwise,
+		 * which puts -0.0 before 0.0 and NaNs at the ends.
+		 */
+		template <class K, class Enable = void>
+		struct radix_key_traits;
+
+		template <class K>
+		struct radix_key_traits<K, typename std::enable_if<std::is_integral<K>::value && !std::is_same<K, bool>::value>::type>{
+			typedef typename std::make_unsigned<K>::type type;
+
+			static inline type encode(K key){
+				return type(key) ^ (std::is_signed<K>::value ? type(type(1) << (8*sizeof(K) - 1)) : type(0));
+			}
+		};
+
+		template <class K>
+		struct radix_key_traits<K, typename std::enable_if<std::is_floating_point<K>::value>::type>{
+			static_assert(sizeof(K) == 4 || sizeof(K) == 8, "radix_sort supports float and double keys");
+			typedef typename std::conditional<sizeof(K) == 4, std::uint32_t, std::uint64_t>::type type;
+
+			static inline type encode(K key){
+				type bits;
+				std::memcpy(&bits, &key, sizeof(bits));
+				const type sign = type(1) << (8*sizeof(K) - 1);
+				return bits ^ ((bits & sign) ? type(~type(0)) : sign);
+			}
+		};
+
+		/**
+		 * @brief      Encoded key type for sorting elements of T by Key.
+		 */
+		template <class T, class Key>
+		using radix_key_t = radix_key_traits<typename std::decay<decltype(std::declval<const Key&>()(std::declval<const T&>()))>::type>;
+
+		/**
+		 * @brief      Key extractor returning the element itself.
+		 */
+		struct identity_key{
+			template <class T>
+			inline const T& operator()(const T& value) const {return value;}
+		};
+
+		/**
+		 * @brief      Below this many elements the radix passes cost more than a comparison sort.
+		 */
+		const std::size_t radix_sort_cutoff = 256;
+
+		/**
+		 * @brief      Stable comparison sort on the encoded keys, for ranges too small to radix sort.
+		 */
+		template <class T, class Key>
+		inline void small_key_sort(T* data, std::size_t n, const Key& key){
+			typedef radix_key_t<T, Key> traits;
+			std::stable_sort(data, data + n, [&key](const T& a, const T& b){return traits::encode(key(a)) < traits::encode(key(b));});
+		}
+
+		/**
+		 * @brief      LSD radix sort of data on the lowest digits bytes of the encoded key, ping-ponging with buffer.
+		 * All the histograms are built in one pass and digits where every element falls in the same bucket are skipped.
+		 *
+		 * @param      data    Elements to sort
+		 * @param      buffer  Scratch space for n constructed elements
+		 * @param[in]  n       Number of elements
+		 * @param[in]  key     Key extractor
+		 * @param[in]  digits  Number of low key bytes to sort on
+		 *
+		 * @return     True if the sorted elements ended up in buffer, False if they are in data.
+		 */
+		template <class T, class Key>
+		bool radix_sort_lsd(T* data, T* buffer, std::size_t n, const Key& key, std::size_t digits){
+			typedef radix_key_t<T, Key> traits;
+			typedef typename traits::type encoded;
+			std::size_t counts[sizeof(encoded)][256] = {};
+			for (std::size_t i = 0; i < n; ++i){
+				const encoded k = traits::encode(key(data[i]));
+				for (std::size_t d = 0; d < digits; ++d)
+					++counts[d][(k >> (8*d)) & 0xff];
+			}
+			bool in_buffer = false;
+			for (std::size_t d = 0; d < digits; ++d){
+				std::size_t* offsets = counts[d];
+				if (offsets[(traits::encode(key(data[0])) >> (8*d)) & 0xff] == n)
+					continue;
+				std::size_t sum = 0;
+				for (std::size_t b = 0; b < 256; ++b){
+					const std::size_t count = offsets[b];
+					offsets[b] = sum;
+					sum += count;
+				}
+				for (std::size_t i = 0; i < n; ++i)
+					buffer[offsets[(traits::encode(key(data[i])) >> (8*d)) & 0xff]++] = std::move(data[i]);
+				std::swap(data, buffer);
+				in_buffer = !in_buffer;
+			}
+			return in_buffer;
+		}
+	}
+
+	/**
+	 * @brief      Finds the first element equal to value. 32 and 64 bit arithmetic vectors are scanned with SIMD.
+	 *
+	 * @param      vec    The vector
+	 * @param[in]  value  Value to look for
+	 *
+	 * @return     Iterator to the element, end() if there is none.
+	 */
+	template <class T, class Alloc, class U>
+	typename vector<T, Alloc>::iterator find(vector<T, Alloc>& vec, const U& value){
+		return vec.begin() + detail::find_index(vec.data(), vec.size(), value, detail::is_simd_searchable<T, U>());
+	}
+
+	template <class T, class Alloc, class U>
+	typename vector<T, Alloc>::const_iterator find(const vector<T, Alloc>& vec, const U& value){
+		return vec.begin() + detail::find_index(vec.data(), vec.size(), value, detail::is_simd_searchable<T, U>());
+	}
+
+	/**
+	 * @brief      Counts the elements equal to value.
+	 *
+	 * @param[in]  vec    The vector
+	 * @param[in]  value  Value to count
+	 *
+	 * @return     Number of matching elements.
+	 */
+	template <class T, class Alloc, class U>
+	typename vector<T, Alloc>::size_type count(const vector<T, Alloc>& vec, const U& value){
+		return detail::count_equal(vec.data(), vec.size(), value, detail::is_simd_searchable<T, U>());
+	}
+
+	/**
+	 * @brief      Checks whether the vector holds an element equal to value.
+	 *
+	 * @param[in]  vec    The vector
+	 * @param[in]  value  Value to look for
+	 *
+	 * @return     True if it does, False otherwise.
+	 */
+	template <class T, class Alloc, class U>
+	bool contains(const vector<T, Alloc>& vec, const U& value){
+		return find(vec, value) != vec.end();
+	}
+
+	/**
+	 * @brief      Finds the first element equal to any of values.
+	 *
+	 * @param      vec     The vector
+	 * @param[in]  values  Range of values to look for
+	 *
+	 * @return     Iterator to the element, end() if there is none.
+	 */
+	template <class T, class Alloc, class Range>
+	typename vector<T, Alloc>::iterator find_first_of(vector<T, Alloc>& vec, const Range& values){
+		typedef typename std::iterator_traits<decltype(std::begin(values))>::value_type value_type;
+		return vec.begin() + detail::find_first_of_index(vec.data(), vec.size(), values, detail::is_simd_searchable<T, value_type>());
+	}
+
+	template <class T, class Alloc, class Range>
+	typename vector<T, Alloc>::const_iterator find_first_of(const vector<T, Alloc>& vec, const Range& values){
+		typedef typename std::iterator_traits<decltype(std::begin(values))>::value_type value_type;
+		return vec.begin() + detail::find_first_of_index(vec.data(), vec.size(), values, detail::is_simd_searchable<T, value_type>());
+	}
+
+	/**
+	 * @brief      Finds the first smallest and the last largest element, like std::minmax_element.
+	 *
+	 * @param      vec   The vector
+	 *
+	 * @return     Pair of iterators to the smallest and largest element, both end() for an empty vector.
+	 */
+	template <class T, class Alloc>
+	std::pair<typename vector<T, Alloc>::iterator, typename vector<T, Alloc>::iterator> minmax_element(vector<T, Alloc>& vec){
+		const std::pair<std::size_t, std::size_t> r = detail::minmax_index(vec.data(), vec.size(), simd::is_lane_type<T>());
+		return std::make_pair(vec.begin() + r.first, vec.begin() + r.second);
+	}
+
+	template <class T, class Alloc>
+	std::pair<typename vector<T, Alloc>::const_iterator, typename vector<T, Alloc>::const_iterator> minmax_element(const vector<T, Alloc>& vec){
+		const std::pair<std::size_t, std::size_t> r = detail::minmax_index(vec.data(), vec.size(), simd::is_lane_type<T>());
+		return std::make_pair(vec.begin() + r.first, vec.begin() + r.second);
+	}
+
+	/**
+	 * @brief      Smallest and largest element of a non-empty vector of 32 or 64 bit arithmetic values.
+	 * If the vector holds a NaN the result is the one of std::minmax_element.
+	 *
+	 * @param[in]  vec   The vector
+	 *
+	 * @return     Pair of the smallest and the largest value.
+	 */
+	template <class T, class Alloc, typename = typename std::enable_if<simd::is_lane_type<T>::value>::type>
+	std::pair<T, T> minmax(const vector<T, Alloc>& vec){
+		assert(!vec.empty());
+		const typename simd::detail::minmax_kernel<T>::result r = simd::minmax(vec.data(), vec.size());
+		if (!r.unordered)
+			return std::make_pair(r.min, r.max);
+		const std::pair<std::size_t, std::size_t> i = detail::minmax_index(vec.data(), vec.size(), std::false_type());
+		return std::make_pair(vec[i.first], vec[i.second]);
+	}
+
+	/**
+	 * @brief      y += a * x, element by element.
+	 *
+	 * @param[in]  a     Factor
+	 * @param[in]  x     Vector added, same size as y
+	 * @param      y     Vector added to
+	 */
+	template <class T, class Alloc, class Alloc2>
+	void axpy(T a, const vector<T, Alloc>& x, vector<T, Alloc2>& y){
+		assert(x.size() == y.size());
+		simd::axpy(a, x.data(), y.data(), y.size());
+	}
+
+	/**
+	 * @brief      Dot product of two vectors of 32 or 64 bit arithmetic values of the same size.
+	 */
+	template <class T, class Alloc, class Alloc2, typename = typename std::enable_if<simd::is_lane_type<T>::value>::type>
+	T dot(const vector<T, Alloc>& x, const vector<T, Alloc2>& y){
+		assert(x.size() == y.size());
+		return simd::dot(x.data(), y.data(), x.size());
+	}
+
+	/**
+	 * @brief      Sum of a vector of 32 or 64 bit arithmetic values.
+	 */
+	template <class T, class Alloc, typename = typename std::enable_if<simd::is_lane_type<T>::value>::type>
+	T sum(const vector<T, Alloc>& vec){
+		return simd::sum(vec.data(), vec.size());
+	}
+
+	/**
+	 * @brief      Replaces every element with the sum of the elements up to and including it.
+	 *
+	 * @param      vec   The vector
+	 *
+	 * @return     The sum of all the elements.
+	 */
+	template <class T, class Alloc>
+	T prefix_sum(vector<T, Alloc>& vec){
+		return simd::prefix_sum(vec.data(), vec.data(), vec.size());
+	}
+
+	/**
+	 * @brief      Clamps every element to [low, high].
+	 */
+	template <class T, class Alloc>
+	void clamp(vector<T, Alloc>& vec, T low, T high){
+		simd::clamp(vec.data(), vec.data(), vec.size(), low, high);
+	}
+
+	/**
+	 * @brief      Resizes out to the size of in and fills it with the converted elements. Converts between arithmetic
+	 * types like static_cast, and between float and simd::half rounding to nearest even.
+	 *
+	 * @param[in]  in    Source vector
+	 * @param      out   Destination vector
+	 */
+	template <class From, class Alloc, class To, class Alloc2>
+	void convert(const vector<From, Alloc>& in, vector<To, Alloc2>& out){
+		out.resize(in.size());
+		simd::convert(in.data(), out.data(), in.size());
+	}
+
+	/**
+	 * @brief      Counts the elements in each of bins equal-width bins over [low, high], see simd::histogram.
+	 *
+	 * @param[in]  vec   The vector
+	 * @param[in]  low   Lower end of the first bin
+	 * @param[in]  high  Upper end of the last bin, greater than low
+	 * @param[in]  bins  Number of bins
+	 *
+	 * @return     bins counts. Elements out of the range are not counted.
+	 */
+	template <class T, class Alloc>
+	vector<std::size_t> histogram(const vector<T, Alloc>& vec, T low, T high, std::size_t bins){
+		vector<std::size_t> counts(bins);
+		simd::histogram(vec.data(), vec.size(), low, high, counts.data(), bins);
+		return counts;
+	}
+
+	/**
+	 * @brief      Removes all the elements satisfying pred in a single pass and shrinks the vector.
+	 * Arithmetic elements are compacted with SIMD, the predicate is still evaluated one element at a time.
+	 *
+	 * @param      vec        The vector
+	 * @param[in]  pred       Unary predicate, true for elements to remove
+	 *
+	 * @tparam     T          Element type
+	 * @tparam     Alloc      Allocator type
+	 * @tparam     Predicate  Predicate type
+	 *
+	 * @return     Number of removed elements.
+	 */
+	template <class T, class Alloc, class Predicate>
+	typename vector<T, Alloc>::size_type erase_if(vector<T, Alloc>& vec, Predicate pred){
+		const typename vector<T, Alloc>::size_type old_size = vec.size();
+		T* data = vec.data();
+		const std::size_t kept = simd::compact(data, old_size, [data, &pred](std::size_t first, std::size_t count){
+			std::uint64_t keep = 0;
+			for (std::size_t i = 0; i < count; ++i)
+				keep |= std::uint64_t(!pred(data[first + i])) << i;
+			return keep;
+		});
+		vec.erase(vec.begin() + kept, vec.end());
+		return old_size - kept;
+	}
+
+	/**
+	 * @brief      Removes all the elements equal to value in a single pass and shrinks the vector.
+	 *
+	 * @param      vec    The vector
+	 * @param[in]  value  Value to remove
+	 *
+	 * @tparam     T      Element type
+	 * @tparam     Alloc  Allocator type
+	 * @tparam     U      Value type, comparable with T
+	 *
+	 * @return     Number of removed elements.
+	 */
+	template <class T, class Alloc, class U>
+	typename vector<T, Alloc>::size_type erase_value(vector<T, Alloc>& vec, const U& value){
+		return erase_if(vec, [&value](const T& element){return element == value;});
+	}
+
+	/**
+	 * @brief      Keeps only the elements whose bit is set in keep_mask, in a single pass.
+	 *
+	 * @param      vec        The vector
+	 * @param[in]  keep_mask  Bitmask, bit i % 64 of word i / 64 keeps element i. Must hold (size + 63) / 64 words.
+	 *
+	 * @tparam     T          Element type
+	 * @tparam     Alloc      Allocator type
+	 *
+	 * @return     Number of removed elements.
+	 */
+	template <class T, class Alloc>
+	typename vector<T, Alloc>::size_type compact_by_mask(vector<T, Alloc>& vec, const std::uint64_t* keep_mask){
+		const typename vector<T, Alloc>::size_type old_size = vec.size();
+		const std::size_t kept = simd::compact(vec.data(), old_size, [keep_mask](std::size_t first, std::size_t count){
+			const std::uint64_t word = keep_mask[first / 64];
+			return count == 64 ? word : word & ((std::uint64_t(1) << count) - 1);
+		});
+		vec.erase(vec.begin() + kept, vec.end());
+		return old_size - kept;
+	}
+
+	/**
+	 * @brief      Stable LSD radix sort by key, one pass per key byte that is not the same for every element.
+	 * Keys are integers, float or double. Elements must be default constructible and move assignable.
+	 *
+	 * @param      vec      The vector
+	 * @param      scratch  Buffer reused between calls, resized to vec.size(). It may swap storage with vec, its content is unspecified afterwards.
+	 * @param[in]  key      Callable returning the key of an element
+	 *
+	 * @tparam     T        Element type
+	 * @tparam     Alloc    Allocator type
+	 * @tparam     Key      Key extractor type
+	 */
+	template <class T, class Alloc, class Key>
+	void radix_sort(vector<T, Alloc>& vec, vector<T, Alloc>& scratch, Key key){
+		const std::size_t n = vec.size();
+		if (n < detail::radix_sort_cutoff){
+			detail::small_key_sort(vec.data(), n, key);
+			return;
+		}
+		scratch.resize(n);
+		const std::size_t digits = sizeof(typename detail::radix_key_t<T, Key>::type);
+		if (detail::radix_sort_lsd(vec.data(), scratch.data(), n, key, digits))
+			vec.swap(scratch);
+	}
+
+	template <class T, class Alloc>
+	void radix_sort(vector<T, Alloc>& vec, vector<T, Alloc>& scratch){
+		radix_sort(vec, scratch, detail::identity_key());
+	}
+
+	template <class T, class Alloc, class Key>
+	void radix_sort(vector<T, Alloc>& vec, Key key){
+		vector<T, Alloc> scratch(vec.get_allocator());
+		radix_sort(vec, scratch, key);
+	}
+
+	template <class T, class Alloc>
+	void radix_sort(vector<T, Alloc>& vec){
+		radix_sort(vec, detail::identity_key());
+	}
+
+	/**
+	 * @brief      Parallel stable radix sort by key. An MSD pass on the highest byte where the keys differ splits the
+	 * elements into 256 buckets, then the buckets are LSD sorted on the bytes below as separate pool tasks.
+	 * Small inputs and single thread pools use radix_sort. The key extractor is called from several threads at once.
+	 *
+	 * @param      vec      The vector
+	 * @param      scratch  Buffer reused between calls, resized to vec.size(). Its content is unspecified afterwards.
+	 * @param[in]  key      Callable returning the key of an element
+	 * @param      pool     Threads to sort with
+	 *
+	 * @tparam     T        Element type
+	 * @tparam     Alloc    Allocator type
+	 * @tparam     Key      Key extractor type
+	 */
+	template <class T, class Alloc, class Key>
+	void parallel_radix_sort(vector<T, Alloc>& vec, vector<T, Alloc>& scratch, Key key, thread_pool& pool){
+		typedef detail::radix_key_t<T, Key> traits;
+		typedef typename traits::type encoded;
+		const std::size_t n = vec.size();
+		const std::size_t chunks = pool.size();
+		if (chunks == 1 || n < 64 * detail::radix_sort_cutoff * chunks){
+			radix_sort(vec, scratch, key);
+			return;
+		}
+		scratch.resize(n);
+		T* const data = vec.data();
+		T* const buffer = scratch.data();
+		const std::size_t chunk_size = (n + chunks - 1) / chunks;
+
+		// Bits where the keys differ, the MSD pass splits on the highest byte holding one.
+		vector<encoded> differ(chunks);
+		pool.parallel_for(chunks, [&](std::size_t c){
+			const std::size_t first = c * chunk_size, last = std::min(n, first + chunk_size);
+			encoded ones = 0, zeros = encoded(~encoded(0));
+			for (std::size_t i = first; i < last; ++i){
+				const encoded k = traits::encode(key(data[i]));
+				ones |= k;
+				zeros &= k;
+			}
+			differ[c] = ones ^ zeros;
+		});
+		encoded bits = 0;
+		for (std::size_t c = 0; c < chunks; ++c)
+			bits |= differ[c];
+		if (bits == 0)
+			return;
+		std::size_t top = sizeof(encoded) - 1;
+		while (top > 0 && ((bits >> (8*top)) & 0xff) == 0)
+			--top;
+
+		// Per chunk histograms of the top digit, turned into per chunk scatter offsets, bucket by bucket.
+		vector<std::size_t> offsets(chunks * 256);
+		pool.parallel_for(chunks, [&](std::size_t c){
+			const std::size_t first = c * chunk_size, last = std::min(n, first + chunk_size);
+			std::size_t* counts = offsets.data() + c*256;
+			for (std::size_t i = first; i < last; ++i)
+				++counts[(traits::encode(key(data[i])) >> (8*top)) & 0xff];
+		});
+		std::size_t bucket_start[257];
+		std::size_t sum = 0;
+		for (std::size_t b = 0; b < 256; ++b){
+			bucket_start[b] = sum;
+			for (std::size_t c = 0; c < chunks; ++c){
+				const std::size_t count = offsets[c*256 + b];
+				offsets[c*256 + b] = sum;
+				sum += count;
+			}
+		}
+		bucket_start[256] = n;
+		pool.parallel_for(chunks, [&](std::size_t c){
+			const std::size_t first = c * chunk_size, last = std::min(n, first + chunk_size);
+			std::size_t* next = offsets.data() + c*256;
+			for (std::size_t i = first; i < last; ++i)
+				buffer[next[(traits::encode(key(data[i])) >> (8*top)) & 0xff]++] = std::move(data[i]);
+		});
+
+		// Buckets are sorted on the lower digits and land back in vec.
+		pool.parallel_for(256, [&](std::size_t b){
+			const std::size_t first = bucket_start[b], count = bucket_start[b + 1] - first;
+			if (count < detail::radix_sort_cutoff){
+				std::move(buffer + first, buffer + first + count, data + first);
+				detail::small_key_sort(data + first, count, key);
+			} else if (!detail::radix_sort_lsd(buffer + first, data + first, count, key, top)){
+				std::move(buffer + first, buffer + first + count, data + first);
+			}
+		});
+	}
+
+	template <class T, class Alloc, class Key>
+	void parallel_radix_sort(vector<T, Alloc>& vec, Key key){
+		vector<T, Alloc> scratch(vec.get_allocator());
+		parallel_radix_sort(vec, scratch, key, thread_pool::shared());
+	}
+
+	template <class T, class Alloc>
+	void parallel_radix_sort(vector<T, Alloc>& vec){
+		parallel_radix_sort(vec, detail::identity_key());
+	}
+
+	namespace detail{
+		/**
+		 * @brief      Elements per thread below which a scan stays on the calling thread.
+		 */
+		const std::size_t parallel_scan_cutoff = 1 << 15;
+
+		template <bool Exclusive, class T>
+		inline T scan_block(const T* in, T* out, std::size_t n, T carry, std::true_type){
+			return Exclusive ? simd::exclusive_prefix_sum(in, out, n, carry) : simd::prefix_sum(in, out, n, carry);
+		}
+
+		template <bool Exclusive, class T>
+		inline T scan_block(const T* in, T* out, std::size_t n, T carry, std::false_type){
+			for (std::size_t i = 0; i < n; ++i){
+				const T value = in[i];
+				out[i] = Exclusive ? carry : T(carry + value);
+				carry = T(carry + value);
+			}
+			return carry;
+		}
+
+		template <class T>
+		inline T block_sum(const T* in, std::size_t n, std::true_type){
+			return simd::sum(in, n);
+		}
+
+		template <class T>
+		inline T block_sum(const T* in, std::size_t n, std::false_type){
+			T total = T();
+			for (std::size_t i = 0; i < n; ++i)
+				total = T(total + in[i]);
+			return total;
+		}
+
+		/**
+		 * @brief      Scans in to out, out may be in. With several threads the input is split in one block per thread:
+		 * the blocks are summed in parallel, the block sums are scanned into starting carries, then the blocks are
+		 * scanned in parallel from their carries.
+		 *
+		 * @return     init plus the sum of all the elements.
+		 */
+		template <bool Exclusive, class T>
+		T scan(const T* in, T* out, std::size_t n, T init, thread_pool& pool){
+			typedef std::integral_constant<bool, simd::is_lane_type<T>::value> lanes;
+			const std::size_t chunks = pool.size();
+			if (chunks == 1 || n < parallel_scan_cutoff * chunks)
+				return scan_block<Exclusive>(in, out, n, init, lanes());
+			const std::size_t chunk_size = (n + chunks - 1) / chunks;
+			vector<T> carries(chunks);
+			pool.parallel_for(chunks, [&](std::size_t c){
+				const std::size_t first = std::min(n, c * chunk_size), last = std::min(n, first + chunk_size);
+				carries[c] = block_sum(in + first, last - first, lanes());
+			});
+			T carry = init;
+			for (std::size_t c = 0; c < chunks; ++c){
+				const T total = carries[c];
+				carries[c] = carry;
+				carry = T(carry + total);
+			}
+			pool.parallel_for(chunks, [&](std::size_t c){
+				const std::size_t first = std::min(n, c * chunk_size), last = std::min(n, first + chunk_size);
+				scan_block<Exclusive>(in + first, out + first, last - first, carries[c], lanes());
+			});
+			return carry;
+		}
+	}
+
+	/**
+	 * @brief      Inclusive scan, out[i] = in[0] + ... + in[i]. 32 and 64 bit arithmetic elements use the SIMD kernels,
+	 * large inputs are split over the pool. Parallel floating point scans add the blocks in a different order than a
+	 * sequential scan, so they can differ from it in the last bits.
+	 *
+	 * @param[in]  in    Source vector
+	 * @param      out   Destination vector, resized to in.size(). May be in.
+	 * @param      pool  Threads to scan with
+	 *
+	 * @return     The sum of all the elements.
+	 */
+	template <class T, class Alloc>
+	T inclusive_scan(const vector<T, Alloc>& in, vector<T, Alloc>& out, thread_pool& pool){
+		out.resize(in.size());
+		return detail::scan<false>(in.data(), out.data(), in.size(), T(), pool);
+	}
+
+	template <class T, class Alloc>
+	T inclusive_scan(const vector<T, Alloc>& in, vector<T, Alloc>& out){
+		return inclusive_scan(in, out, thread_pool::shared());
+	}
+
+	/**
+	 * @brief      In-place inclusive scan, see inclusive_scan(in, out, pool).
+	 */
+	template <class T, class Alloc>
+	T inclusive_scan(vector<T, Alloc>& vec, thread_pool& pool){
+		return detail::scan<false>(vec.data(), vec.data(), vec.size(), T(), pool);
+	}
+
+	template <class T, class Alloc>
+	T inclusive_scan(vector<T, Alloc>& vec){
+		return inclusive_scan(vec, thread_pool::shared());
+	}
+
+	/**
+	 * @brief      Exclusive scan, out[i] = init + in[0] + ... + in[i - 1]. Turns counts into offsets.
+	 * Uses the same kernels and splitting as inclusive_scan.
+	 *
+	 * @param[in]  in    Source vector
+	 * @param      out   Destination vector, resized to in.size(). May be in.
+	 * @param[in]  init  Value of the first element
+	 * @param      pool  Threads to scan with
+	 *
+	 * @return     init plus the sum of all the elements, the end offset.
+	 *
+	 * @tparam     U     Type of init, deduced so that std::exclusive_scan found by argument dependent lookup is not a
+	 * better match when init needs a conversion to T.
+	 */
+	template <class T, class Alloc, class U, typename = typename std::enable_if<std::is_convertible<U, T>::value>::type>
+	T exclusive_scan(const vector<T, Alloc>& in, vector<T, Alloc>& out, U init, thread_pool& pool){
+		out.resize(in.size());
+		return detail::scan<true>(in.data(), out.data(), in.size(), static_cast<T>(init), pool);
+	}
+
+	template <class T, class Alloc>
+	T exclusive_scan(const vector<T, Alloc>& in, vector<T, Alloc>& out, typename vector<T, Alloc>::value_type init = T()){
+		return exclusive_scan(in, out, init, thread_pool::shared());
+	}
+
+	/**
+	 * @brief      In-place exclusive scan, see exclusive_scan(in, out, init, pool).
+	 */
+	template <class T, class Alloc>
+	T exclusive_scan(vector<T, Alloc>& vec, typename vector<T, Alloc>::value_type init, thread_pool& pool){
+		return detail::scan<true>(vec.data(), vec.data(), vec.size(), init, pool);
+	}
+
+	template <class T, class Alloc>
+	T exclusive_scan(vector<T, Alloc>& vec, typename vector<T, Alloc>::value_type init = T()){
+		return exclusive_scan(vec, init, thread_pool::shared());
+	}
+
+	/**
+	 * @brief      Data cache sizes in bytes, 0 for a level the CPU does not have.
+	 */
+	struct cache_info{
+		std::size_t l1;
+		std::size_t l2;
+		std::size_t l3;
+	};
+
+	namespace detail{
+		/**
+		 * @brief      Reads the first line of a small text file.
+		 *
+		 * @return     false if the file can not be read.
+		 */
+		inline bool read_line(const char* path, char* line, std::size_t size){
+			std::FILE* file = std::fopen(path, "r");
+			if (!file)
+				return false;
+			const bool read = std::fgets(line, int(size), file) != nullptr;
+			std::fclose(file);
+			return read;
+		}
+
+		/**
+		 * @brief      Parses a size as sysfs prints it, such as 48K or 32M.
+		 */
+		inline std::size_t parse_cache_size(const char* text){
+			char* end;
+			const std::size_t size = std::strtoull(text, &end, 10);
+			switch (*end){
+				case 'K': return size << 10;
+				case 'M': return size << 20;
+				case 'G': return size << 30;
+				default: return size;
+			}
+		}
+
+		inline cache_info detect_cache(){
+			cache_info cache = {0, 0, 0};
+#if defined(__linux__)
+			char path[64], line[32];
+			for (int index = 0;; ++index){
+				std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+				if (!read_line(path, line, sizeof(line)))
+					break;
+				const int level = std::atoi(line);
+				std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+				if (!read_line(path, line, sizeof(line)) || std::strncmp(line, "Instruction", 11) == 0)
+					continue;
+				std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+				if (!read_line(path, line, sizeof(line)))
+					continue;
+				const std::size_t size = parse_cache_size(line);
+				if (level == 1)
+					cache.l1 = size;
+				else if (level == 2)
+					cache.l2 = size;
+				else if (level == 3)
+					cache.l3 = size;
+			}
+#endif
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+			const long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE), l2 = sysconf(_SC_LEVEL2_CACHE_SIZE), l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+			if (cache.l1 == 0 && l1 > 0)
+				cache.l1 = l1;
+			if (cache.l2 == 0 && l2 > 0)
+				cache.l2 = l2;
+			if (cache.l3 == 0 && l3 > 0)
+				cache.l3 = l3;
+#endif
+			if (cache.l1 == 0)
+				cache.l1 = 32 << 10;
+			if (cache.l2 == 0)
+				cache.l2 = 256 << 10;
+			return cache;
+		}
+
+		/**
+		 * @brief      Number of elements of type T in bytes, at least one.
+		 */
+		template <class T>
+		inline std::size_t block_elements(std::size_t bytes){
+			return bytes >= sizeof(T) ? bytes / sizeof(T) : 1;
+		}
+	}
+
+	/**
+	 * @brief      Data cache sizes of the first CPU, detected once. Read from sysfs on Linux, then sysconf, and taken
+	 * as 32 KiB L1 and 256 KiB L2 if neither tells.
+	 */
+	inline const cache_info& detected_cache(){
+		static const cache_info cache = detail::detect_cache();
+		return cache;
+	}
+
+	/**
+	 * @brief      Calls fn with consecutive spans of the elements, bytes long except the last one. Running all the passes
+	 * of a multi-pass computation on a block before moving to the next keeps the block in cache between the passes.
+	 *
+	 * @param      vec    The vector
+	 * @param[in]  bytes  Size of a block, rounded down to whole elements
+	 * @param[in]  fn     Callable taking a fake::span<T>
+	 *
+	 * @return     fn
+	 */
+	template <class T, class Alloc, class Function>
+	Function for_each_block(vector<T, Alloc>& vec, std::size_t bytes, Function fn){
+		for (span<T> block : vec.chunks(detail::block_elements<T>(bytes)))
+			fn(block);
+		return fn;
+	}
+
+	template <class T, class Alloc, class Function>
+	Function for_each_block(const vector<T, Alloc>& vec, std::size_t bytes, Function fn){
+		for (span<const T> block : vec.chunks(detail::block_elements<T>(bytes)))
+			fn(block);
+		return fn;
+	}
+
+	/**
+	 * @brief      for_each_block with blocks of half the L2 cache, which leaves room for whatever else the passes touch.
+	 */
+	template <class T, class Alloc, class Function>
+	Function for_each_block(vector<T, Alloc>& vec, Function fn){
+		return for_each_block(vec, detected_cache().l2 / 2, fn);
+	}
+
+	template <class T, class Alloc, class Function>
+	Function for_each_block(const vector<T, Alloc>& vec, Function fn){
+		return for_each_block(vec, detected_cache().l2 / 2, fn);
+	}
+
+	namespace detail{
+		/**
+		 * @brief      Gather of any element and index types, prefetching distance elements ahead.
+		 */
+		template <class T, class Index>
+		void gather(const T* table, const Index* indices, std::size_t n, T* out, std::size_t distance, std::false_type){
+			for (std::size_t i = 0; i < n; ++i){
+				if (distance != 0 && i + distance < n)
+					__builtin_prefetch(table + indices[i + distance]);
+				out[i] = table[indices[i]];
+			}
+		}
+
+		template <class T, class Index>
+		inline void gather(const T* table, const Index* indices, std::size_t n, T* out, std::size_t distance, std::true_type){
+			simd::gather(table, indices, n, out, distance);
+		}
+
+		/**
+		 * @brief      Scatter prefetching distance elements ahead for writing. AVX-512 scatter instructions measured
+		 * slower than this loop, so there is no SIMD kernel.
+		 */
+		template <class T, class Index>
+		void scatter(const T* values, const Index* indices, std::size_t n, T* table, std::size_t distance){
+			for (std::size_t i = 0; i < n; ++i){
+				if (distance != 0 && i + distance < n)
+					__builtin_prefetch(table + indices[i + distance], 1);
+				table[indices[i]] = values[i];
+			}
+		}
+
+		/**
+		 * @brief      Hardware gathers sign extend 32 bit indices, larger tables take the scalar loop.
+		 */
+		template <class Index>
+		inline bool fits_gather_index(std::size_t table_size){
+			return sizeof(Index) == 8 || table_size <= std::size_t(INT32_MAX) + 1;
+		}
+	}
+
+	/**
+	 * @brief      Resizes out to indices.size() and sets out[i] = table[indices[i]]. 32 and 64 bit arithmetic elements
+	 * with integer indices of the same size use gather instructions where the CPU has them.
+	 *
+	 * @param[in]  table     The table
+	 * @param[in]  indices   Positions in table
+	 * @param      out       Destination vector
+	 * @param[in]  distance  How many elements ahead the table is prefetched, 0 for no prefetching
+	 */
+	template <class T, class Alloc, class Index, class Alloc2, class Alloc3>
+	void gather(const vector<T, Alloc>& table, const vector<Index, Alloc2>& indices, vector<T, Alloc3>& out, std::size_t distance){
+		assert(std::all_of(indices.begin(), indices.end(), [&](Index i){return std::size_t(i) < table.size();}) && "index out of range");
+		out.resize(indices.size());
+		if (detail::fits_gather_index<Index>(table.size()))
+			detail::gather(table.data(), indices.data(), indices.size(), out.data(), distance, simd::is_gather_type<T, Index>());
+		else
+			detail::gather(table.data(), indices.data(), indices.size(), out.data(), distance, std::false_type());
+	}
+
+	/**
+	 * @brief      gather prefetching simd::default_prefetch_distance elements ahead when the table is larger than the
+	 * L2 cache, and not at all otherwise.
+	 */
+	template <class T, class Alloc, class Index, class Alloc2, class Alloc3>
+	void gather(const vector<T, Alloc>& table, const vector<Index, Alloc2>& indices, vector<T, Alloc3>& out){
+		gather(table, indices, out, table.size() * sizeof(T) > detected_cache().l2 ? simd::default_prefetch_distance : 0);
+	}
+
+	/**
+	 * @brief      Sets table[indices[i]] = values[i]. With repeated indices the last value wins.
+	 *
+	 * @param[in]  values    Values to store, as many as indices
+	 * @param[in]  indices   Positions in table
+	 * @param      table     The table
+	 * @param[in]  distance  How many elements ahead the table is prefetched, 0 for no prefetching
+	 */
+	template <class T, class Alloc, class Index, class Alloc2, class Alloc3>
+	void scatter(const vector<T, Alloc>& values, const vector<Index, Alloc2>& indices, vector<T, Alloc3>& table, std::size_t distance){
+		assert(values.size() == indices.size());
+		assert(std::all_of(indices.begin(), indices.end(), [&](Index i){return std::size_t(i) < table.size();}) && "index out of range");
+		detail::scatter(values.data(), indices.data(), indices.size(), table.data(), distance);
+	}
+
+	/**
+	 * @brief      scatter prefetching like gather(table, indices, out).
+	 */
+	template <class T, class Alloc, class Index, class Alloc2, class Alloc3>
+	void scatter(const vector<T, Alloc>& values, const vector<Index, Alloc2>& indices, vector<T, Alloc3>& table){
+		scatter(values, indices, table, table.size() * sizeof(T) > detected_cache().l2 ? simd::default_prefetch_distance : 0);
+	}
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef FAKEALLOCATOR_H
+#define FAKEALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#if defined(__unix__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace fake{
+	/**
+	 * @brief      Allocator on top of malloc and calloc that can hand out zeroed memory. fake::vector value-initializes
+	 * zero-initializable elements (see fake::is_zero_initializable) with allocate_zeroed instead of writing zeros.
+	 * Large calloc requests are served with fresh pages from the kernel, which are zeroed on first touch,
+	 * so building a large zeroed vector costs next to nothing until its pages are used.
+	 *
+	 * @tparam     T     Element type, at most as aligned as std::max_align_t
+	 */
+	template <class T>
+	class zeroed_allocator{
+	public:
+		typedef T value_type;
+
+		static_assert(alignof(T) <= alignof(std::max_align_t), "zeroed_allocator does not over-align");
+
+		zeroed_allocator() noexcept {}
+		template <class U>
+		zeroed_allocator(const zeroed_allocator<U>&) noexcept {}
+
+		/**
+		 * @brief      Allocates uninitialized memory for n elements.
+		 */
+		T* allocate(std::size_t n){
+			if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				throw std::bad_alloc();
+			void* memory = std::malloc(n * sizeof(T));
+			if (!memory)
+				throw std::bad_alloc();
+			return static_cast<T*>(memory);
+		}
+
+		/**
+		 * @brief      Allocates memory for n elements with all bytes zero.
+		 */
+		T* allocate_zeroed(std::size_t n){
+			void* memory = std::calloc(n, sizeof(T));
+			if (!memory)
+				throw std::bad_alloc();
+			return static_cast<T*>(memory);
+		}
+
+		void deallocate(T* p, std::size_t) noexcept {
+			std::free(p);
+		}
+	};
+
+	template <class T, class U>
+	inline bool operator==(const zeroed_allocator<T>&, const zeroed_allocator<U>&){return true;}
+
+	template <class T, class U>
+	inline bool operator!=(const zeroed_allocator<T>&, const zeroed_allocator<U>&){return false;}
+
+	/**
+	 * @brief      Allocator that makes fake::vector shrink on its own. Once removing elements leaves the size under a
+	 * quarter of the capacity, the array is reallocated to twice the size. The gap between the quarter and the half
+	 * keeps a vector that grows and shrinks around one size from reallocating on every step.
+	 * Removing elements then invalidates all iterators, like growing does.
+	 *
+	 * @tparam     T     Element type
+	 */
+	template <class T>
+	class shrinking_allocator{
+	public:
+		typedef T value_type;
+		static const bool shrink_when_sparse = true;
+
+		shrinking_allocator() noexcept {}
+		template <class U>
+		shrinking_allocator(const shrinking_allocator<U>&) noexcept {}
+
+		T* allocate(std::size_t n){
+			if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+				throw std::bad_alloc();
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		void deallocate(T* p, std::size_t) noexcept {
+			::operator delete(p);
+		}
+	};
+
+	template <class T, class U>
+	inline bool operator==(const shrinking_allocator<T>&, const shrinking_allocator<U>&){return true;}
+
+	template <class T, class U>
+	inline bool operator!=(const shrinking_allocator<T>&, const shrinking_allocator<U>&){return false;}
+
+	/**
+	 * @brief      Process wide list of containers that can give memory back, for trimming them all at once when
+	 * memory runs low. A container is listed for the lifetime of a trim_registration and trimmed with its trim() member.
+	 */
+	class trim_registry{
+	private:
+		struct entry{
+			void* object;
+			void (*trim)(void*);
+		};
+
+		std::mutex mutex_;
+		std::vector<entry> entries_;
+
+		template <class Container>
+		static void trim_object(void* object){
+			static_cast<Container*>(object)->trim();
+		}
+
+	public:
+		void add(void* object, void (*trim)(void*)){
+			std::lock_guard<std::mutex> lock(mutex_);
+			entries_.push_back(entry{object, trim});
+		}
+
+		void remove(void* object){
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (std::size_t i = 0; i < entries_.size(); ++i)
+				if (entries_[i].object == object){
+					entries_[i] = entries_.back();
+					entries_.pop_back();
+					return;
+				}
+		}
+
+		template <class Container>
+		void add(Container& container){
+			add(&container, &trim_object<Container>);
+		}
+
+		/**
+		 * @brief      Trims every listed container, then hands the free memory of the C heap back to the system
+		 * (malloc_trim, with glibc). The containers must not be in use by other threads meanwhile.
+		 *
+		 * @return     Number of containers trimmed.
+		 */
+		std::size_t trim_all(){
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (const entry& e : entries_)
+				e.trim(e.object);
+#if defined(__GLIBC__)
+			::malloc_trim(0);
+#endif
+			return entries_.size();
+		}
+
+		/**
+		 * @brief      The process wide registry.
+		 */
+		static trim_registry& shared(){
+			static trim_registry registry;
+			return registry;
+		}
+	};
+
+	/**
+	 * @brief      Keeps a container in trim_registry::shared() while it is alive. Must not outlive the container.
+	 */
+	class trim_registration{
+	private:
+		void* object_;
+	public:
+		template <class Container>
+		explicit trim_registration(Container& container) :
+			object_(&container)
+			{
+				trim_registry::shared().add(container);
+			};
+
+		trim_registration(const trim_registration&) = delete;
+		trim_registration& operator=(const trim_registration&) = delete;
+
+		~trim_registration(){
+			trim_registry::shared().remove(object_);
+		}
+	};
+
+	/**
+	 * @brief      Trims every container in the process wide registry. Meant to be called when memory runs low.
+	 *
+	 * @return     Number of containers trimmed.
+	 */
+	inline std::size_t trim_all(){
+		return trim_registry::shared().trim_all();
+	}
+
+#if defined(__unix__)
+	namespace detail{
+		/**
+		 * @brief      Size of a virtual memory page.
+		 */
+		inline std::size_t page_size(){
+			static const std::size_t size = ::sysconf(_SC_PAGESIZE);
+			return size;
+		}
+
+		/**
+		 * @brief      Rounds a byte count up to whole pages.
+		 */
+		inline std::size_t round_to_pages(std::size_t bytes){
+			const std::size_t page = page_size();
+			return (bytes + page - 1) / page * page;
+		}
+
+		/**
+		 * @brief      Maps private anonymous memory, which reads as zero and takes up physical memory only once written.
+		 *
+		 * @param[in]  bytes       Size of the mapping, a multiple of the page size
+		 * @param[in]  protection  PROT_READ | PROT_WRITE, or PROT_NONE to only reserve address space
+		 * @param[in]  reserve     False to map without reserving swap space for it (MAP_NORESERVE), so mappings
+		 * larger than the memory can be made under the default overcommit policy
+		 *
+		 * @return     Start of the mapping. Throws std::bad_alloc if it cannot be made.
+		 */
+		inline void* map_pages(std::size_t bytes, int protection, bool reserve){
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_NORESERVE)
+			if (!reserve)
+				flags |= MAP_NORESERVE;
+#endif
+			void* memory = ::mmap(nullptr, bytes, protection, flags, -1, 0);
+			if (memory == MAP_FAILED)
+				throw std::bad_alloc();
+			return memory;
+		}
+
+		inline void unmap_pages(void* memory, std::size_t bytes){
+			if (memory)
+				::munmap(memory, bytes);
+		}
+
+		/**
+		 * @brief      Gives the physical memory of the whole pages inside [first, last) back to the system without
+		 * unmapping them. The pages read as zero afterwards, or, when released lazily, keep their contents until
+		 * the system actually needs the memory.
+		 *
+		 * @param[in]  first  Start of the range
+		 * @param[in]  last   End of the range
+		 * @param[in]  lazy   MADV_FREE instead of MADV_DONTNEED, where available
+		 *
+		 * @return     Number of bytes released.
+		 */
+		inline std::size_t release_pages(void* first, void* last, bool lazy){
+			const std::size_t page = page_size();
+			const std::size_t begin = (reinterpret_cast<std::size_t>(first) + page - 1) / page * page;
+			const std::size_t end = reinterpret_cast<std::size_t>(last) / page * page;
+			if (begin >= end)
+				return 0;
+			int advice = MADV_DONTNEED;
+#if defined(MADV_FREE)
+			if (lazy)
+				advice = MADV_FREE;
+#endif
+			if (::madvise(reinterpret_cast<void*>(begin), end - begin, advice) != 0)
+				return 0;
+			return end - begin;
+		}
+	}
+#endif
+}
+
+#endif
@@ -0,0 +1,442 @@
+#ifndef FAKEBUDGET_H
+#define FAKEBUDGET_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "fakeAllocator.h"
+#if defined(__unix__)
+#include <fcntl.h>
+#endif
+
+namespace fake{
+	class memory_budget;
+
+	/**
+	 * @brief      Thrown when an allocation does not fit in its budget.
+	 */
+	class budget_exhausted : public std::bad_alloc{
+	private:
+		std::string message_;
+	public:
+		explicit budget_exhausted(const std::string& name) :
+			message_("memory budget " + name + " exhausted")
+			{};
+		const char* what() const noexcept override {return message_.c_str();}
+	};
+
+	namespace detail{
+		/**
+		 * @brief      Budgets alive in the process, by address, with the id they were created with. Lets a thread
+		 * returning its cached credit at exit skip budgets that are gone.
+		 */
+		struct budget_registry{
+			std::mutex mutex;
+			std::unordered_map<const memory_budget*, unsigned long> budgets;
+			unsigned long next_id = 0;
+
+			static budget_registry& shared(){
+				static budget_registry registry;
+				return registry;
+			}
+		};
+
+		/**
+		 * @brief      Credit a thread has already charged to a budget and hands out to its own allocations.
+		 * Only the thread touches budget and id; bytes is atomic because the budget may take the credit back.
+		 */
+		struct budget_credit{
+			memory_budget* budget = nullptr;
+			unsigned long id = 0;
+			std::atomic<std::size_t> bytes{0};
+		};
+
+		/**
+		 * @brief      Per-thread credit for the few budgets a thread allocates from. Returned when the thread exits.
+		 */
+		struct budget_cache{
+			static const std::size_t slot_count = 4;
+			budget_credit slots[slot_count];
+
+			~budget_cache();
+
+			static budget_cache& local(){
+				static thread_local budget_cache cache;
+				return cache;
+			}
+		};
+
+#if defined(__unix__)
+		/**
+		 * @brief      Maps a new unlinked file in directory, for memory that should live on disk instead of in RAM.
+		 *
+		 * @param[in]  directory  Directory for the file
+		 * @param[in]  bytes      Size of the mapping, a multiple of the page size
+		 *
+		 * @return     Start of the mapping. Throws std::bad_alloc if it cannot be made.
+		 */
+		inline void* map_temporary_file(const std::string& directory, std::size_t bytes){
+			std::string path = directory + "/fake-spill-XXXXXX";
+			const int fd = ::mkstemp(&path[0]);
+			if (fd < 0)
+				throw std::bad_alloc();
+			::unlink(path.c_str());
+			void* memory = MAP_FAILED;
+			if (::ftruncate(fd, bytes) == 0)
+				memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (memory == MAP_FAILED)
+				throw std::bad_alloc();
+			return memory;
+		}
+#endif
+	}
+
+	/**
+	 * @brief      Named cap on the memory allocated through budget_allocator, shared by any number of containers
+	 * and threads. Allocations are charged to an atomic counter and refused once it would pass the limit.
+	 * To keep the counter off the hot path, allocations smaller than the batch size are charged in batches:
+	 * each thread takes a batch of credit at a time and hands it out to its own allocations. used() can therefore
+	 * run ahead of the bytes actually allocated by up to two batches per thread. The batch is capped at 1/64 of the
+	 * limit, and before an allocation is refused the credit parked in every thread is taken back and the allocation
+	 * charged exactly, so an allocation that fits next to the live bytes is not refused because of batching.
+	 * A budget must outlive the containers using it.
+	 */
+	class memory_budget{
+	public:
+		/**
+		 * @brief      What happens to an allocation that does not fit.
+		 */
+		enum class exhaustion{
+			raise, ///< throw budget_exhausted
+			callback, ///< call the handler, which can make room (e.g. fake::trim_all) and ask for a retry
+			spill ///< serve it uncharged from a temporary file mapping, so it is backed by disk instead of RAM
+		};
+
+		/**
+		 * Handler for exhaustion::callback. Gets the budget and the requested bytes, returns true to retry.
+		 */
+		typedef std::function<bool(memory_budget&, std::size_t)> handler;
+
+		static const std::size_t default_batch = std::size_t(1) << 16;
+	private:
+		std::string name_;
+		std::size_t limit_;
+		std::size_t batch_;
+		exhaustion policy_;
+		handler handler_;
+		std::string spill_directory_;
+		unsigned long id_;
+		std::atomic<std::size_t> used_;
+		std::atomic<std::size_t> spilled_bytes_;
+		std::mutex spill_mutex_;
+		std::unordered_map<void*, std::size_t> spilled_;
+		/**
+		 * Credit slots of the threads allocating from this budget, to take their credit back.
+		 */
+		std::mutex credits_mutex_;
+		std::vector<detail::budget_credit*> credits_;
+
+		friend struct detail::budget_cache;
+
+		/**
+		 * @brief      Charges bytes to the shared counter if they fit under the limit.
+		 */
+		bool take(std::size_t bytes){
+			std::size_t used = used_.load(std::memory_order_relaxed);
+			do {
+				if (bytes > limit_ || used > limit_ - bytes)
+					return false;
+			} while (!used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+			return true;
+		}
+
+		void give(std::size_t bytes){
+			used_.fetch_sub(bytes, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief      Credit slot of the calling thread for this budget, null if the thread has no free slot.
+		 */
+		inline detail::budget_credit* local_credit(){
+			for (detail::budget_credit& slot : detail::budget_cache::local().slots)
+				if (slot.budget == this && slot.id == id_)
+					return &slot;
+			return claim_credit();
+		}
+
+		/**
+		 * @brief      Gives this budget a credit slot of the calling thread: an unused one, or one left by a destroyed budget.
+		 */
+		[[gnu::noinline]]
+		detail::budget_credit* claim_credit(){
+			detail::budget_registry& registry = detail::budget_registry::shared();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			for (detail::budget_credit& slot : detail::budget_cache::local().slots){
+				if (slot.budget){
+					auto it = registry.budgets.find(slot.budget);
+					if (it != registry.budgets.end() && it->second == slot.id)
+						continue;
+				}
+				slot.budget = this;
+				slot.id = id_;
+				slot.bytes.store(0, std::memory_order_relaxed);
+				std::lock_guard<std::mutex> credits_lock(credits_mutex_);
+				credits_.push_back(&slot);
+				return &slot;
+			}
+			return nullptr;
+		}
+
+		/**
+		 * @brief      Gives back the credit of a thread that exits. Called with the registry locked.
+		 */
+		void release_credit(detail::budget_credit& slot){
+			std::lock_guard<std::mutex> lock(credits_mutex_);
+			for (std::size_t i = 0; i < credits_.size(); ++i)
+				if (credits_[i] == &slot){
+					credits_[i] = credits_.back();
+					credits_.pop_back();
+					break;
+				}
+			give(slot.bytes.exchange(0, std::memory_order_relaxed));
+		}
+
+		/**
+		 * @brief      Takes back the credit parked in every thread.
+		 */
+		void reclaim(){
+			std::lock_guard<std::mutex> lock(credits_mutex_);
+			for (detail::budget_credit* credit : credits_)
+				if (const std::size_t bytes = credit->bytes.exchange(0, std::memory_order_relaxed))
+					give(bytes);
+		}
+
+		/**
+		 * @brief      Charges exactly bytes to the shared counter, taking back parked credit if they do not fit.
+		 */
+		bool take_exact(std::size_t bytes){
+			if (take(bytes))
+				return true;
+			reclaim();
+			return take(bytes);
+		}
+
+		/**
+		 * @brief      Charges bytes, from the thread's credit when they are smaller than a batch.
+		 */
+		bool charge(std::size_t bytes){
+			if (bytes < batch_)
+				if (detail::budget_credit* credit = local_credit()){
+					std::size_t available = credit->bytes.load(std::memory_order_relaxed);
+					while (available >= bytes)
+						if (credit->bytes.compare_exchange_weak(available, available - bytes, std::memory_order_relaxed))
+							return true;
+					if (take(batch_)){
+						credit->bytes.fetch_add(batch_ - bytes, std::memory_order_relaxed);
+						return true;
+					}
+				}
+			return take_exact(bytes);
+		}
+
+		void refund(std::size_t bytes){
+			if (bytes < batch_)
+				if (detail::budget_credit* credit = local_credit()){
+					if (credit->bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes > 2 * batch_)
+						give(credit->bytes.exchange(0, std::memory_order_relaxed));
+					return;
+				}
+			give(bytes);
+		}
+
+		[[gnu::noinline, gnu::cold]]
+		void* allocate_exhausted(std::size_t bytes){
+			switch (policy_){
+			case exhaustion::callback:
+				while (handler_ && handler_(*this, bytes))
+					if (charge(bytes))
+						return ::operator new(bytes);
+				break;
+#if defined(__unix__)
+			case exhaustion::spill: {
+				void* memory = detail::map_temporary_file(spill_directory_, detail::round_to_pages(bytes));
+				std::lock_guard<std::mutex> lock(spill_mutex_);
+				spilled_.emplace(memory, bytes);
+				spilled_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+				return memory;
+			}
+#endif
+			default:
+				break;
+			}
+			throw budget_exhausted(name_);
+		}
+
+		/**
+		 * @brief      Unmaps p if it was spilled.
+		 *
+		 * @return     False if p is not a spilled allocation.
+		 */
+		bool deallocate_spilled(void* p){
+			std::lock_guard<std::mutex> lock(spill_mutex_);
+			auto it = spilled_.find(p);
+			if (it == spilled_.end())
+				return false;
+			detail::unmap_pages(p, detail::round_to_pages(it->second));
+			spilled_bytes_.fetch_sub(it->second, std::memory_order_relaxed);
+			spilled_.erase(it);
+			return true;
+		}
+
+	public:
+		/**
+		 * @brief      Creates a budget.
+		 *
+		 * @param[in]  name    Name, reported by budget_exhausted
+		 * @param[in]  limit   Bytes that may be allocated at the same time
+		 * @param[in]  policy  What happens to an allocation that does not fit
+		 * @param[in]  batch   Bytes of credit a thread takes at a time, at most limit / 64. 0 charges every allocation
+		 * to the shared counter
+		 */
+		memory_budget(std::string name, std::size_t limit, exhaustion policy = exhaustion::raise, std::size_t batch = default_batch) :
+			name_(std::move(name)),
+			limit_(limit),
+			batch_(std::max<std::size_t>(1, std::min(batch, limit / 64))),
+			policy_(policy),
+			spill_directory_("/tmp"),
+			used_(0),
+			spilled_bytes_(0)
+			{
+				detail::budget_registry& registry = detail::budget_registry::shared();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				id_ = ++registry.next_id;
+				registry.budgets[this] = id_;
+			};
+
+		memory_budget(const memory_budget&) = delete;
+		memory_budget& operator=(const memory_budget&) = delete;
+
+		~memory_budget(){
+			detail::budget_registry& registry = detail::budget_registry::shared();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.budgets.erase(this);
+		}
+
+		/**
+		 * @brief      Allocates bytes charged to the budget, applying the exhaustion policy if they do not fit.
+		 */
+		void* allocate(std::size_t bytes){
+			if (__builtin_expect(charge(bytes), 1))
+				return ::operator new(bytes);
+			return allocate_exhausted(bytes);
+		}
+
+		void deallocate(void* p, std::size_t bytes){
+			if (spilled_bytes_.load(std::memory_order_relaxed) && deallocate_spilled(p))
+				return;
+			::operator delete(p);
+			refund(bytes);
+		}
+
+		inline const std::string& name() const {return name_;}
+		inline std::size_t limit() const {return limit_;}
+
+		/**
+		 * @brief      Bytes charged, including the credit threads hold but have not handed out yet.
+		 */
+		inline std::size_t used() const {return used_.load(std::memory_order_relaxed);}
+
+		/**
+		 * @brief      Bytes currently served from spill files, not counted in used().
+		 */
+		inline std::size_t spilled() const {return spilled_bytes_.load(std::memory_order_relaxed);}
+
+		/**
+		 * @brief      Sets the handler called by exhaustion::callback.
+		 */
+		void set_handler(handler fn){handler_ = std::move(fn);}
+
+		/**
+		 * @brief      Sets the directory of the spill files, /tmp by default.
+		 */
+		void set_spill_directory(std::string directory){spill_directory_ = std::move(directory);}
+
+		/**
+		 * @brief      Hands the calling thread's unused credit back, so used() is exact again for this thread.
+		 */
+		void flush_thread(){
+			for (detail::budget_credit& slot : detail::budget_cache::local().slots)
+				if (slot.budget == this && slot.id == id_)
+					give(slot.bytes.exchange(0, std::memory_order_relaxed));
+		}
+	};
+
+	inline detail::budget_cache::~budget_cache(){
+		budget_registry& registry = budget_registry::shared();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for (budget_credit& slot : slots){
+			if (!slot.budget)
+				continue;
+			auto it = registry.budgets.find(slot.budget);
+			if (it != registry.budgets.end() && it->second == slot.id)
+				slot.budget->release_credit(slot);
+		}
+	}
+
+	/**
+	 * @brief      Allocator charging a memory_budget, e.g. fake::vector<int, fake::budget_allocator<int>> v(alloc).
+	 * Every array a vector allocates is charged, and released when the vector frees it.
+	 *
+	 * @tparam     T     Element type
+	 */
+	template <class T>
+	class budget_allocator{
+	private:
+		memory_budget* budget_;
+
+		template <class U>
+		friend class budget_allocator;
+	public:
+		typedef T value_type;
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		explicit budget_allocator(memory_budget& budget) noexcept :
+			budget_(&budget)
+			{};
+
+		template <class U>
+		budget_allocator(const budget_allocator<U>& other) noexcept :
+			budget_(other.budget_)
+			{};
+
+		T* allocate(std::size_t n){
+			if (n > std::size_t(-1) / sizeof(T))
+				throw std::bad_alloc();
+			return static_cast<T*>(budget_->allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T* p, std::size_t n){
+			budget_->deallocate(p, n * sizeof(T));
+		}
+
+		inline memory_budget& budget() const {return *budget_;}
+
+		template <class U>
+		bool operator==(const budget_allocator<U>& other) const {return budget_ == other.budget_;}
+		template <class U>
+		bool operator!=(const budget_allocator<U>& other) const {return budget_ != other.budget_;}
+	};
+}
+
+#endif
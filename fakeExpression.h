@@ -0,0 +1,373 @@
+#ifndef FAKEEXPRESSION_H
+#define FAKEEXPRESSION_H
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "fakeVector.h"
+#include "fakeSimd.h"
+
+namespace fake{
+	/**
+	 * Element-wise arithmetic on vectors of arithmetic types. a + b * c builds a tree of lightweight nodes instead of
+	 * temporary vectors, the tree is evaluated in one SIMD pass when it is assigned to a vector or reduced with
+	 * sum, dot or norm. Nodes refer to the vectors they were built from, so they must not outlive them.
+	 */
+	namespace expression{
+		/**
+		 * @brief      Size reported by scalar operands, they fit any vector size.
+		 */
+		const std::size_t any_size = std::size_t(-1);
+
+		/**
+		 * @brief      Leaf reading the elements of a vector.
+		 */
+		template <class T>
+		class terminal{
+		private:
+			const T* data_;
+			std::size_t size_;
+		public:
+			typedef T value_type;
+
+			terminal(const T* data, std::size_t size) :
+				data_(data),
+				size_(size)
+				{};
+
+			inline std::size_t size() const {return size_;}
+			[[gnu::always_inline]] inline T operator[](std::size_t i) const {return data_[i];}
+
+			template <class V>
+			[[gnu::always_inline]] inline void load(V& v, std::size_t i) const {simd::detail::load(v, data_ + i);}
+		};
+
+		/**
+		 * @brief      Leaf repeating one value, for expressions such as 2.f * a.
+		 */
+		template <class T>
+		class scalar{
+		private:
+			T value_;
+		public:
+			typedef T value_type;
+
+			explicit
+			scalar(T value) :
+				value_(value)
+				{};
+
+			inline std::size_t size() const {return any_size;}
+			[[gnu::always_inline]] inline T operator[](std::size_t) const {return value_;}
+
+			template <class V>
+			[[gnu::always_inline]] inline void load(V& v, std::size_t) const {v = V{} + value_;}
+		};
+
+		/**
+		 * @brief      Applies Operation to the elements of two nodes.
+		 */
+		template <class Operation, class Left, class Right>
+		class binary{
+		private:
+			Left left_;
+			Right right_;
+			std::size_t size_;
+		public:
+			typedef typename Left::value_type value_type;
+
+			binary(const Left& left, const Right& right) :
+				left_(left),
+				right_(right),
+				size_(left.size() < right.size() ? left.size() : right.size())
+				{
+					assert((left.size() == right.size() || left.size() == any_size || right.size() == any_size) && "operand sizes differ");
+				};
+
+			inline std::size_t size() const {return size_;}
+
+			[[gnu::always_inline]] inline value_type operator[](std::size_t i) const {
+				value_type result;
+				Operation::apply(result, left_[i], right_[i]);
+				return result;
+			}
+
+			template <class V>
+			[[gnu::always_inline]] inline void load(V& v, std::size_t i) const {
+				V left, right;
+				left_.load(left, i);
+				right_.load(right, i);
+				Operation::apply(v, left, right);
+			}
+		};
+
+		/**
+		 * @brief      Negates the elements of a node.
+		 */
+		template <class Operand>
+		class negation{
+		private:
+			Operand operand_;
+		public:
+			typedef typename Operand::value_type value_type;
+
+			explicit
+			negation(const Operand& operand) :
+				operand_(operand)
+				{};
+
+			inline std::size_t size() const {return operand_.size();}
+			[[gnu::always_inline]] inline value_type operator[](std::size_t i) const {return -operand_[i];}
+
+			template <class V>
+			[[gnu::always_inline]] inline void load(V& v, std::size_t i) const {
+				operand_.load(v, i);
+				v = -v;
+			}
+		};
+
+		// Operations write through a reference, returning wide vectors by value changes the ABI.
+		struct plus{template <class X> [[gnu::always_inline]] static inline void apply(X& out, const X& a, const X& b){out = a + b;}};
+		struct minus{template <class X> [[gnu::always_inline]] static inline void apply(X& out, const X& a, const X& b){out = a - b;}};
+		struct multiplies{template <class X> [[gnu::always_inline]] static inline void apply(X& out, const X& a, const X& b){out = a * b;}};
+		struct divides{template <class X> [[gnu::always_inline]] static inline void apply(X& out, const X& a, const X& b){out = a / b;}};
+
+		/**
+		 * @brief      Evaluated expression: root node plus the vector interface of is_vector_expression.
+		 */
+		template <class Node>
+		class lazy;
+
+		template <class T>
+		struct is_element : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> {};
+
+		template <class... Types>
+		struct make_void{typedef void type;};
+
+		/**
+		 * @brief      Checks whether a number of type U converts to T without narrowing.
+		 */
+		template <class U, class T, class Enable = void>
+		struct is_lossless_conversion : std::false_type {};
+
+		template <class U, class T>
+		struct is_lossless_conversion<U, T, typename make_void<decltype(T{std::declval<U>()})>::type> : std::true_type {};
+
+		/**
+		 * @brief      Turns an operand into a node: vectors into terminals, lazy expressions into their root, numbers that
+		 * convert to value_type without narrowing into scalars. A scalar that would be truncated, like 2.5 next to
+		 * int elements, makes no node, so the expression does not compile. Not defined for anything else, which keeps the operators away from unrelated types.
+		 */
+		template <class Operand, class T, class Enable = void>
+		struct node_of{};
+
+		template <class T, class Alloc>
+		struct node_of<fake::vector<T, Alloc>, T, typename std::enable_if<is_element<T>::value>::type>{
+			typedef terminal<T> type;
+			static inline type make(const fake::vector<T, Alloc>& vec){return type(vec.data(), vec.size());}
+		};
+
+		template <class Node>
+		struct node_of<lazy<Node>, typename Node::value_type>{
+			typedef Node type;
+			static inline const type& make(const lazy<Node>& e){return e.node();}
+		};
+
+		template <class U, class T>
+		struct node_of<U, T, typename std::enable_if<is_element<U>::value && is_lossless_conversion<U, T>::value>::type>{
+			typedef scalar<T> type;
+			static inline type make(U value){return type(T{value});}
+		};
+
+		/**
+		 * @brief      Element type of a vector or lazy expression operand, void for anything else.
+		 */
+		template <class Operand>
+		struct element_of{typedef void type;};
+
+		template <class T, class Alloc>
+		struct element_of<fake::vector<T, Alloc>>{typedef typename std::conditional<is_element<T>::value, T, void>::type type;};
+
+		template <class Node>
+		struct element_of<lazy<Node>>{typedef typename Node::value_type type;};
+
+		/**
+		 * @brief      Element type of a binary expression: taken from whichever side is a vector or expression.
+		 */
+		template <class Left, class Right>
+		struct common_element{
+			typedef typename element_of<Left>::type left;
+			typedef typename element_of<Right>::type right;
+			typedef typename std::conditional<std::is_void<left>::value, right, left>::type type;
+		};
+
+		/**
+		 * @brief      Result of a binary operator. Has no type unless both operands make nodes of the same element type,
+		 * so the operators drop out of overload resolution for everything else.
+		 */
+		template <class Operation, class Left, class Right, class T = typename common_element<Left, Right>::type, class Enable = void>
+		struct binary_result{};
+
+		template <class Operation, class Left, class Right, class T>
+		struct binary_result<Operation, Left, Right, T, typename make_void<typename node_of<Left, T>::type, typename node_of<Right, T>::type>::type>{
+			typedef lazy<binary<Operation, typename node_of<Left, T>::type, typename node_of<Right, T>::type>> type;
+		};
+
+		/**
+		 * @brief      Writes n elements of an expression, whole vectors at a time and the tail one by one.
+		 */
+		template <class Node>
+		struct evaluate_kernel{
+			typedef typename Node::value_type T;
+
+			template <std::size_t Bytes>
+			[[gnu::always_inline]] static inline void run(const Node* node, T* out, std::size_t n){
+				typedef typename simd::detail::vector_of<T, Bytes>::type V;
+				const std::size_t lanes = Bytes / sizeof(T);
+				std::size_t i = 0;
+				for (; i + lanes <= n; i += lanes){
+					V v;
+					node->load(v, i);
+					simd::detail::store(out + i, v);
+				}
+				for (; i < n; ++i)
+					out[i] = (*node)[i];
+			}
+		};
+
+		/**
+		 * @brief      Sum of n elements of an expression, with two vector accumulators. Floating point sums are
+		 * reassociated, so they can differ from a sequential sum in the last bits.
+		 */
+		template <class Node>
+		struct sum_kernel{
+			typedef typename Node::value_type T;
+
+			template <std::size_t Bytes>
+			[[gnu::always_inline]] static inline T run(const Node* node, std::size_t n){
+				typedef typename simd::detail::vector_of<T, Bytes>::type V;
+				const std::size_t lanes = Bytes / sizeof(T);
+				V first = V{}, second = V{};
+				std::size_t i = 0;
+				for (; i + 2*lanes <= n; i += 2*lanes){
+					V a, b;
+					node->load(a, i);
+					node->load(b, i + lanes);
+					first += a;
+					second += b;
+				}
+				first += second;
+				T total = T();
+				for (std::size_t j = 0; j < lanes; ++j)
+					total += first[j];
+				for (; i < n; ++i)
+					total += (*node)[i];
+				return total;
+			}
+		};
+
+		template <class Node>
+		class lazy{
+		private:
+			Node node_;
+		public:
+			typedef typename Node::value_type value_type;
+
+			explicit
+			lazy(const Node& node) :
+				node_(node)
+				{};
+
+			inline const Node& node() const {return node_;}
+			inline std::size_t size() const {return node_.size();}
+			inline value_type operator[](std::size_t i) const {return node_[i];}
+
+			/**
+			 * @brief      Writes all the elements to out in one pass.
+			 *
+			 * @param      out   Destination for size() elements, may be one of the operands
+			 */
+			void evaluate(value_type* out) const {
+				simd::detail::dispatch<evaluate_kernel<Node>>(&node_, out, size());
+			}
+
+			/**
+			 * @brief      Sum of all the elements, computed in one pass without storing them.
+			 */
+			value_type sum() const {
+				return simd::detail::dispatch<sum_kernel<Node>>(&node_, size());
+			}
+		};
+
+		template <class Left, class Right>
+		typename binary_result<plus, Left, Right>::type operator+(const Left& left, const Right& right){
+			typedef typename common_element<Left, Right>::type T;
+			return typename binary_result<plus, Left, Right>::type({node_of<Left, T>::make(left), node_of<Right, T>::make(right)});
+		}
+
+		template <class Left, class Right>
+		typename binary_result<minus, Left, Right>::type operator-(const Left& left, const Right& right){
+			typedef typename common_element<Left, Right>::type T;
+			return typename binary_result<minus, Left, Right>::type({node_of<Left, T>::make(left), node_of<Right, T>::make(right)});
+		}
+
+		template <class Left, class Right>
+		typename binary_result<multiplies, Left, Right>::type operator*(const Left& left, const Right& right){
+			typedef typename common_element<Left, Right>::type T;
+			return typename binary_result<multiplies, Left, Right>::type({node_of<Left, T>::make(left), node_of<Right, T>::make(right)});
+		}
+
+		template <class Left, class Right>
+		typename binary_result<divides, Left, Right>::type operator/(const Left& left, const Right& right){
+			typedef typename common_element<Left, Right>::type T;
+			return typename binary_result<divides, Left, Right>::type({node_of<Left, T>::make(left), node_of<Right, T>::make(right)});
+		}
+
+		template <class Operand, class T = typename element_of<Operand>::type>
+		lazy<negation<typename node_of<Operand, T>::type>> operator-(const Operand& operand){
+			return lazy<negation<typename node_of<Operand, T>::type>>(negation<typename node_of<Operand, T>::type>(node_of<Operand, T>::make(operand)));
+		}
+
+		/**
+		 * @brief      Sum of the elements of a vector or expression, in one pass.
+		 */
+		template <class Operand, class T = typename element_of<Operand>::type>
+		T sum(const Operand& operand){
+			typedef typename node_of<Operand, T>::type node;
+			return lazy<node>(node_of<Operand, T>::make(operand)).sum();
+		}
+
+		/**
+		 * @brief      Dot product of two vectors or expressions of the same size, in one pass.
+		 */
+		template <class Left, class Right, class T = typename common_element<Left, Right>::type>
+		T dot(const Left& left, const Right& right){
+			return (left * right).sum();
+		}
+
+		/**
+		 * @brief      Euclidean norm of a vector or expression.
+		 */
+		template <class Operand, class T = typename element_of<Operand>::type>
+		auto norm(const Operand& operand) -> decltype(std::sqrt(T())){
+			return std::sqrt(dot(operand, operand));
+		}
+	}
+
+	namespace detail{
+		template <class Node>
+		struct is_vector_expression<expression::lazy<Node>> : std::true_type {};
+	}
+
+	using expression::operator+;
+	using expression::operator-;
+	using expression::operator*;
+	using expression::operator/;
+	using expression::sum;
+	using expression::dot;
+	using expression::norm;
+}
+
+#endif
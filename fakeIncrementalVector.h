@@ -0,0 +1,329 @@
+#ifndef FAKEINCREMENTALVECTOR_H
+#define FAKEINCREMENTALVECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "fakeAllocator.h"
+
+namespace fake{
+	/**
+	 * @brief      Vector whose push_back takes constant time in the worst case, not just amortized. Growing allocates the
+	 * next array (twice as large) but copies nothing: the old array stays alive and every push_back afterwards moves
+	 * a few of its elements over, starting from the top, the way incremental rehashing spreads a hash table resize.
+	 * Doubling leaves as many push_backs before the next growth as there are elements to move, so moving two per
+	 * push_back always finishes in time.
+	 *
+	 * While elements are moving, the first old_elements() of them live in the old array and the others in the new one.
+	 * operator[] and at() pick the right one with a single comparison. Anything that needs the elements
+	 * contiguous (iterators, data()) or removes elements first moves the remaining ones over in one go.
+	 * A const vector cannot move anything, so its iterators go through operator[] instead of pointing into one array,
+	 * and it has no data(): while elements are moving there is no single array to point to.
+	 * References from operator[] stay valid until the next push_back, which may move the element.
+	 * The pages of the old array are given back to the system as it empties, so freeing it does not stall either.
+	 *
+	 * @tparam     T     Element type
+	 */
+	template <class T>
+	class incremental_vector{
+	public:
+		typedef T 				value_type;
+		typedef T& 				reference;
+		typedef const T& 		const_reference;
+		typedef T* 				pointer;
+		typedef const T* 		const_pointer;
+		typedef T* 				iterator;
+		typedef std::size_t 	size_type;
+		typedef std::ptrdiff_t 	difference_type;
+
+		/**
+		 * @brief      Iterator of a const vector, an index read through operator[], so it works while elements are moving.
+		 */
+		class const_iterator{
+		private:
+			const incremental_vector* vector_;
+			size_type index_;
+		public:
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const T* pointer;
+			typedef const T& reference;
+
+			const_iterator() : vector_(nullptr), index_(0) {};
+			const_iterator(const incremental_vector* vector, size_type index) : vector_(vector), index_(index) {};
+
+			inline reference operator*() const {return (*vector_)[index_];}
+			inline pointer operator->() const {return &(*vector_)[index_];}
+			inline reference operator[](difference_type n) const {return (*vector_)[index_ + n];}
+
+			inline const_iterator& operator++(){++index_; return *this;}
+			inline const_iterator operator++(int){const_iterator it = *this; ++index_; return it;}
+			inline const_iterator& operator--(){--index_; return *this;}
+			inline const_iterator operator--(int){const_iterator it = *this; --index_; return it;}
+			inline const_iterator& operator+=(difference_type n){index_ += n; return *this;}
+			inline const_iterator& operator-=(difference_type n){index_ -= n; return *this;}
+			inline const_iterator operator+(difference_type n) const {return const_iterator(vector_, index_ + n);}
+			inline const_iterator operator-(difference_type n) const {return const_iterator(vector_, index_ - n);}
+			friend inline const_iterator operator+(difference_type n, const const_iterator& it){return it + n;}
+			inline difference_type operator-(const const_iterator& it) const {return difference_type(index_ - it.index_);}
+
+			inline bool operator==(const const_iterator& it) const {return index_ == it.index_;}
+			inline bool operator!=(const const_iterator& it) const {return index_ != it.index_;}
+			inline bool operator<(const const_iterator& it) const {return index_ < it.index_;}
+			inline bool operator>(const const_iterator& it) const {return index_ > it.index_;}
+			inline bool operator<=(const const_iterator& it) const {return index_ <= it.index_;}
+			inline bool operator>=(const const_iterator& it) const {return index_ >= it.index_;}
+		};
+
+		/**
+		 * Elements moved from the old array by each push_back.
+		 */
+		static const size_type migrate_per_push = 2;
+	private:
+		/**
+		 * Bytes of the emptied part of the old array given back to the system at a time.
+		 */
+		static const size_type release_step = size_type(1) << 20;
+
+		pointer array_start_;
+		pointer array_end_;
+		pointer array_range_end_;
+		/**
+		 * Old array while elements are moving, null otherwise.
+		 */
+		pointer old_start_;
+		/**
+		 * Number of elements still in the old array, they are the first ones.
+		 */
+		size_type old_size_;
+		/**
+		 * End of the part of the old array whose pages have not been given back yet.
+		 */
+		pointer old_unreleased_end_;
+
+		static pointer allocate(size_type n){
+			if (n > size_type(-1) / sizeof(T))
+				throw std::bad_alloc();
+			return static_cast<pointer>(::operator new(n * sizeof(T)));
+		}
+
+		static void deallocate(pointer p){
+			::operator delete(p);
+		}
+
+		/**
+		 * @brief      Moves up to count elements from the top of the old array, and frees it once it is empty.
+		 *
+		 * @param[in]  count  Maximum number of elements to move
+		 */
+		void migrate(size_type count){
+			for (; count && old_size_; --count){
+				// counted as moved only once constructed, a throwing copy leaves it in the old array
+				::new(static_cast<void*>(array_start_ + old_size_ - 1)) T(std::move_if_noexcept(old_start_[old_size_ - 1]));
+				--old_size_;
+				old_start_[old_size_].~T();
+			}
+			if (!old_size_){
+				deallocate(old_start_);
+				old_start_ = old_unreleased_end_ = nullptr;
+			}
+#if defined(__unix__)
+			else if (size_type(old_unreleased_end_ - (old_start_ + old_size_)) * sizeof(T) >= release_step){
+				detail::release_pages(old_start_ + old_size_, old_unreleased_end_, false);
+				old_unreleased_end_ = old_start_ + old_size_;
+			}
+#endif
+		}
+
+		/**
+		 * @brief      Moves every element left in the old array, before an operation that needs them contiguous.
+		 */
+		inline void settle(){
+			if (__builtin_expect(old_start_ != nullptr, 0))
+				migrate(old_size_);
+		}
+
+		/**
+		 * @brief      Switches to an array twice as large. The elements stay where they are and move over later.
+		 */
+		[[gnu::noinline, gnu::cold]]
+		void grow(){
+			settle();
+			const size_type old_size = size();
+			const size_type new_capacity = capacity() ? 2 * capacity() : 1;
+			pointer new_array = allocate(new_capacity);
+			if (old_size){
+				old_start_ = array_start_;
+				old_size_ = old_size;
+				old_unreleased_end_ = array_end_;
+			} else
+				deallocate(array_start_);
+			array_start_ = new_array;
+			array_end_ = new_array + old_size;
+			array_range_end_ = new_array + new_capacity;
+		}
+
+		void destroy_elements(pointer first, pointer last){
+			if (!std::is_trivially_destructible<T>::value)
+				for (; first != last; ++first)
+					first->~T();
+		}
+
+	public:
+		incremental_vector() :
+			array_start_(nullptr),
+			array_end_(nullptr),
+			array_range_end_(nullptr),
+			old_start_(nullptr),
+			old_size_(0),
+			old_unreleased_end_(nullptr)
+			{};
+
+		incremental_vector(const incremental_vector&) = delete;
+		incremental_vector& operator=(const incremental_vector&) = delete;
+
+		incremental_vector(incremental_vector&& x) noexcept :
+			incremental_vector()
+			{
+				swap(x);
+			};
+
+		incremental_vector& operator=(incremental_vector&& x) noexcept {
+			swap(x);
+			return *this;
+		}
+
+		~incremental_vector(){
+			if (old_start_){
+				destroy_elements(old_start_, old_start_ + old_size_);
+				deallocate(old_start_);
+			}
+			destroy_elements(array_start_ + old_size_, array_end_);
+			deallocate(array_start_);
+		}
+
+		void swap(incremental_vector& x) noexcept {
+			using std::swap;
+			swap(array_start_, x.array_start_);
+			swap(array_end_, x.array_end_);
+			swap(array_range_end_, x.array_range_end_);
+			swap(old_start_, x.old_start_);
+			swap(old_size_, x.old_size_);
+			swap(old_unreleased_end_, x.old_unreleased_end_);
+		}
+
+		/**
+		 * @brief      Number of elements still waiting in the old array, 0 when the elements are contiguous.
+		 */
+		inline size_type old_elements() const {return old_size_;}
+
+		// Iterators
+
+		inline iterator begin(){settle(); return array_start_;}
+		inline iterator end(){settle(); return array_end_;}
+		inline const_iterator begin() const {return const_iterator(this, 0);}
+		inline const_iterator end() const {return const_iterator(this, size());}
+		inline const_iterator cbegin() const {return begin();}
+		inline const_iterator cend() const {return end();}
+
+		// Capacity
+
+		inline size_type size() const {return array_end_ - array_start_;}
+		inline bool empty() const {return array_end_ == array_start_;}
+		inline size_type capacity() const {return array_range_end_ - array_start_;}
+
+		/**
+		 * @brief      Grows to at least n elements, moving every element on the spot.
+		 */
+		void reserve(size_type n){
+			settle();
+			if (n <= capacity())
+				return;
+			const size_type old_size = size();
+			pointer new_array = allocate(n);
+			for (size_type i = 0; i < old_size; ++i){
+				::new(static_cast<void*>(new_array + i)) T(std::move_if_noexcept(array_start_[i]));
+				array_start_[i].~T();
+			}
+			deallocate(array_start_);
+			array_start_ = new_array;
+			array_end_ = new_array + old_size;
+			array_range_end_ = new_array + n;
+		}
+
+		// Element access
+
+		inline reference operator[](size_type n){
+			return n < old_size_ ? old_start_[n] : array_start_[n];
+		}
+
+		inline const_reference operator[](size_type n) const {
+			return n < old_size_ ? old_start_[n] : array_start_[n];
+		}
+
+		reference at(size_type n){
+			if (n < size())
+				return (*this)[n];
+			else throw std::out_of_range("out of vector range.");
+		}
+
+		const_reference at(size_type n) const {
+			if (n < size())
+				return (*this)[n];
+			else throw std::out_of_range("out of vector range.");
+		}
+
+		inline reference front(){return (*this)[0];}
+		inline const_reference front() const {return (*this)[0];}
+		inline reference back(){return (*this)[size() - 1];}
+		inline const_reference back() const {return (*this)[size() - 1];}
+		inline pointer data(){settle(); return array_start_;}
+
+		// Modifiers
+
+		void push_back(const value_type& val){
+			emplace_back(val);
+		}
+
+		void push_back(value_type&& val){
+			emplace_back(std::move(val));
+		}
+
+		/**
+		 * @brief      Constructs an element at the end, then moves migrate_per_push elements out of the old array.
+		 * Growing moves nothing, so args may refer to an element of the vector.
+		 *
+		 * @param[in]  args       Arguments to forward to the constructor of the element
+		 *
+		 * @tparam     Args       Arguments template
+		 */
+		template <class... Args>
+		void emplace_back(Args&&... args){
+			if (__builtin_expect(array_end_ == array_range_end_, 0))
+				grow();
+			::new(static_cast<void*>(array_end_)) T(std::forward<Args>(args)...);
+			++array_end_;
+			if (old_start_)
+				migrate(migrate_per_push);
+		}
+
+		void pop_back(){
+			settle();
+			--array_end_;
+			array_end_->~T();
+		}
+
+		void clear(){
+			settle();
+			destroy_elements(array_start_, array_end_);
+			array_end_ = array_start_;
+		}
+	};
+}
+
+#endif
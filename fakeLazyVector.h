@@ -0,0 +1,236 @@
+#ifndef FAKELAZYVECTOR_H
+#define FAKELAZYVECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "fakeVector.h"
+#include "fakeAllocator.h"
+
+namespace fake{
+	/**
+	 * @brief      Fixed size table whose elements are constructed block by block on first access, for huge tables of
+	 * which only a fraction is ever touched. The whole table is reserved as address space up front (mmap with
+	 * MAP_NORESERVE), the kernel only backs the pages that are written, and a bitmap tracks the blocks that are constructed.
+	 * A block is a page worth of elements.
+	 * Zero-initializable elements (see fake::is_zero_initializable) need no construction: untouched memory reads as
+	 * zero, so they skip the bitmap and every element counts as constructed.
+	 *
+	 * @tparam     T     Element type, default constructible
+	 */
+	template <class T>
+	class lazy_vector{
+	public:
+		typedef T 				value_type;
+		typedef T& 				reference;
+		typedef const T& 		const_reference;
+		typedef T* 				pointer;
+		typedef const T* 		const_pointer;
+		typedef std::size_t 	size_type;
+	private:
+		typedef std::uint64_t word_type;
+		static const size_type word_bits = 64;
+		static const bool zero_blocks = is_zero_initializable<T>::value;
+
+		/**
+		 * Start of the mapping.
+		 */
+		pointer data_;
+		/**
+		 * Number of elements.
+		 */
+		size_type size_;
+		/**
+		 * Size of the mapping in bytes.
+		 */
+		size_type mapped_bytes_;
+		/**
+		 * Elements per block.
+		 */
+		size_type block_size_;
+		/**
+		 * One bit per block, set once the block is constructed. Empty for zero-initializable elements.
+		 */
+		fake::vector<word_type> constructed_;
+		/**
+		 * Number of set bits.
+		 */
+		size_type constructed_blocks_;
+
+		static size_type mapping_size(size_type n){
+			if (n > size_type(-1) / sizeof(T) - detail::page_size())
+				throw std::bad_alloc();
+			return detail::round_to_pages(n * sizeof(T));
+		}
+
+		inline bool block_constructed(size_type block) const {
+			return constructed_[block / word_bits] >> (block % word_bits) & 1;
+		}
+
+		inline size_type block_end(size_type block) const {
+			const size_type end = (block + 1) * block_size_;
+			return end < size_ ? end : size_;
+		}
+
+		/**
+		 * @brief      Value-initializes the elements of a block. Kept out of line, it runs once per block.
+		 * If a constructor throws, the elements constructed so far are destroyed and the block stays unconstructed.
+		 *
+		 * @param[in]  block  Block index
+		 */
+		[[gnu::noinline, gnu::cold]]
+		void construct_block(size_type block){
+			const size_type first = block * block_size_, last = block_end(block);
+			size_type i = first;
+			try {
+				for (; i < last; ++i)
+					::new(static_cast<void*>(data_ + i)) T();
+			} catch (...) {
+				destroy_range(first, i);
+				throw;
+			}
+			constructed_[block / word_bits] |= word_type(1) << (block % word_bits);
+			++constructed_blocks_;
+		}
+
+		/**
+		 * @brief      Makes sure the block holding element i is constructed.
+		 */
+		inline void materialize(size_type i){
+			if (zero_blocks)
+				return;
+			const size_type block = i / block_size_;
+			if (__builtin_expect(!block_constructed(block), 0))
+				construct_block(block);
+		}
+
+		void destroy_range(size_type first, size_type last){
+			if (!std::is_trivially_destructible<T>::value)
+				for (size_type i = first; i < last; ++i)
+					data_[i].~T();
+		}
+
+		/**
+		 * @brief      Destroys the constructed blocks and unmaps the table.
+		 */
+		void release(){
+			if (!zero_blocks && !std::is_trivially_destructible<T>::value)
+				for (size_type block = 0; constructed_blocks_ && block * block_size_ < size_; ++block)
+					if (block_constructed(block)){
+						destroy_range(block * block_size_, block_end(block));
+						--constructed_blocks_;
+					}
+			detail::unmap_pages(data_, mapped_bytes_);
+		}
+
+	public:
+		/**
+		 * @brief      Reserves address space for n elements without constructing any of them.
+		 * Throws std::bad_alloc if the address space cannot be mapped.
+		 *
+		 * @param[in]  n     Element count
+		 */
+		explicit
+		lazy_vector(size_type n) :
+			data_(nullptr),
+			size_(n),
+			mapped_bytes_(mapping_size(n)),
+			block_size_(detail::page_size() / sizeof(T) ? detail::page_size() / sizeof(T) : 1),
+			constructed_(),
+			constructed_blocks_(0)
+			{
+				if (mapped_bytes_)
+					data_ = static_cast<pointer>(detail::map_pages(mapped_bytes_, PROT_READ | PROT_WRITE, false));
+				if (!zero_blocks)
+					constructed_.resize((n / block_size_ + 1 + word_bits - 1) / word_bits);
+			};
+
+		lazy_vector(const lazy_vector&) = delete;
+		lazy_vector& operator=(const lazy_vector&) = delete;
+
+		lazy_vector(lazy_vector&& x) noexcept :
+			data_(x.data_),
+			size_(x.size_),
+			mapped_bytes_(x.mapped_bytes_),
+			block_size_(x.block_size_),
+			constructed_(std::move(x.constructed_)),
+			constructed_blocks_(x.constructed_blocks_)
+			{
+				x.data_ = nullptr;
+				x.size_ = x.mapped_bytes_ = x.constructed_blocks_ = 0;
+			};
+
+		lazy_vector& operator=(lazy_vector&& x) noexcept {
+			swap(x);
+			return *this;
+		}
+
+		~lazy_vector(){
+			release();
+		}
+
+		void swap(lazy_vector& x) noexcept {
+			using std::swap;
+			swap(data_, x.data_);
+			swap(size_, x.size_);
+			swap(mapped_bytes_, x.mapped_bytes_);
+			swap(block_size_, x.block_size_);
+			constructed_.swap(x.constructed_);
+			swap(constructed_blocks_, x.constructed_blocks_);
+		}
+
+		/**
+		 * @brief      Element i, constructing its block first if needed.
+		 *
+		 * @param[in]  i     Index of an element
+		 *
+		 * @return     Reference to the element.
+		 */
+		inline reference operator[](size_type i){
+			assert(i < size_ && "lazy_vector index out of range");
+			materialize(i);
+			return data_[i];
+		}
+
+		/**
+		 * @brief      Element i without constructing anything. Elements of unconstructed blocks read as a
+		 * value-initialized element.
+		 *
+		 * @param[in]  i     Index of an element
+		 *
+		 * @return     Const_reference to the element.
+		 */
+		inline const_reference operator[](size_type i) const {
+			assert(i < size_ && "lazy_vector index out of range");
+			if (is_constructed(i))
+				return data_[i];
+			static const T value_initialized = T();
+			return value_initialized;
+		}
+
+		/**
+		 * @brief      Checks whether the block holding element i has been constructed.
+		 */
+		inline bool is_constructed(size_type i) const {
+			return zero_blocks || block_constructed(i / block_size_);
+		}
+
+		/**
+		 * @brief      Number of constructed blocks, always 0 for zero-initializable elements which have no bitmap.
+		 */
+		inline size_type constructed_blocks() const {return constructed_blocks_;}
+
+		/**
+		 * @brief      Number of elements per block.
+		 */
+		inline size_type block_size() const {return block_size_;}
+
+		inline size_type size() const {return size_;}
+		inline bool empty() const {return size_ == 0;}
+	};
+}
+
+#endif
@@ -0,0 +1,318 @@
+#ifndef FAKEPREGROWVECTOR_H
+#define FAKEPREGROWVECTOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "fakeVector.h"
+
+namespace fake{
+	/**
+	 * @brief      Vector that grows in the background, so no push_back pays for copying the whole array.
+	 * Once the size passes a watermark of the capacity, the next array (twice as large) is allocated and a background
+	 * thread copies the elements present at that point into it. The push_backs that follow write their element to
+	 * both arrays. When the old array is full, the new one already holds every element and the vector just switches over.
+	 * Small arrays are grown in place like fake::vector, a thread is not worth it for them.
+	 *
+	 * While a growth is in flight, only push_back, emplace_back and const access run concurrently with the copy.
+	 * Any other operation, including non-const element access, first waits for the copy and switches over early.
+	 *
+	 * @tparam     T     Element type, trivially relocatable (see fake::is_trivially_relocatable)
+	 */
+	template <class T>
+	class pregrow_vector{
+	public:
+		typedef T 				value_type;
+		typedef T& 				reference;
+		typedef const T& 		const_reference;
+		typedef T* 				pointer;
+		typedef const T* 		const_pointer;
+		typedef T* 				iterator;
+		typedef const T* 		const_iterator;
+		typedef std::size_t 	size_type;
+
+		static_assert(is_trivially_relocatable<T>::value, "pregrow_vector copies elements bytewise");
+
+		/**
+		 * Smallest array, in bytes, grown in the background.
+		 */
+		static const size_type min_background_bytes = size_type(1) << 20;
+	private:
+		pointer array_start_;
+		pointer array_end_;
+		pointer array_range_end_;
+		/**
+		 * Where push_back stops for the next growth step: the watermark, or the end of the array while growing.
+		 */
+		pointer growth_trigger_;
+		/**
+		 * Next array while a growth is in flight, null otherwise.
+		 */
+		pointer next_start_;
+		size_type next_capacity_;
+		/**
+		 * Thread copying the elements into the next array.
+		 */
+		std::thread copier_;
+		/**
+		 * Fraction of the capacity at which a background growth starts.
+		 */
+		float watermark_;
+
+		static pointer allocate(size_type n){
+			if (n > size_type(-1) / sizeof(T))
+				throw std::bad_alloc();
+			return static_cast<pointer>(::operator new(n * sizeof(T)));
+		}
+
+		static void deallocate(pointer p){
+			::operator delete(p);
+		}
+
+		void set_array(pointer start, size_type size, size_type capacity){
+			array_start_ = start;
+			array_end_ = start + size;
+			array_range_end_ = start + capacity;
+			if (capacity * sizeof(T) < min_background_bytes)
+				growth_trigger_ = array_range_end_;
+			else
+				// past the watermark already, the next growth starts with the next push_back
+				growth_trigger_ = std::max(start + size_type(capacity * watermark_), array_end_);
+		}
+
+		/**
+		 * @brief      Grows to new_capacity on the spot, like fake::vector.
+		 */
+		void grow_now(size_type new_capacity){
+			const size_type old_size = size();
+			pointer new_array = allocate(new_capacity);
+			if (old_size)
+				std::memcpy(static_cast<void*>(new_array), static_cast<const void*>(array_start_), old_size * sizeof(T));
+			deallocate(array_start_);
+			set_array(new_array, old_size, new_capacity);
+		}
+
+		/**
+		 * @brief      Allocates the next array and starts copying the current elements into it in the background.
+		 */
+		void start_growth(){
+			next_capacity_ = 2 * capacity();
+			next_start_ = allocate(next_capacity_);
+			const void* source = array_start_;
+			void* destination = next_start_;
+			const size_type bytes = size() * sizeof(T);
+			try {
+				copier_ = std::thread([=]{std::memcpy(destination, source, bytes);});
+			} catch (const std::system_error&) {
+				std::memcpy(destination, source, bytes);
+			}
+			growth_trigger_ = array_range_end_;
+		}
+
+		/**
+		 * @brief      Waits for the copy and switches to the next array, which holds every element by then.
+		 */
+		void finish_growth(){
+			if (copier_.joinable())
+				copier_.join();
+			const size_type old_size = size();
+			deallocate(array_start_);
+			pointer next = next_start_;
+			next_start_ = nullptr;
+			set_array(next, old_size, next_capacity_);
+		}
+
+		/**
+		 * @brief      Takes the next growth step: grows small arrays on the spot, starts a background growth at the
+		 * watermark, switches over when the array is full.
+		 */
+		[[gnu::noinline, gnu::cold]]
+		void advance_growth(){
+			if (next_start_)
+				finish_growth();
+			else if (capacity() * sizeof(T) < min_background_bytes)
+				grow_now(capacity() ? 2 * capacity() : 1);
+			else
+				start_growth();
+			if (array_end_ == growth_trigger_)
+				advance_growth();
+		}
+
+		/**
+		 * @brief      Ends a growth in flight, before any operation that could race with the copy.
+		 */
+		inline void settle(){
+			if (__builtin_expect(next_start_ != nullptr, 0))
+				finish_growth();
+		}
+
+		void destroy_elements(pointer first, pointer last){
+			if (!std::is_trivially_destructible<T>::value)
+				for (; first != last; ++first)
+					first->~T();
+		}
+
+	public:
+		/**
+		 * @brief      Creates an empty vector.
+		 *
+		 * @param[in]  watermark  Fraction of the capacity, between 0 and 1, at which the next growth starts in the background.
+		 * Lower starts earlier and leaves the copy more time, at the cost of writing more push_backs twice.
+		 */
+		explicit
+		pregrow_vector(float watermark = 0.5f) :
+			array_start_(nullptr),
+			array_end_(nullptr),
+			array_range_end_(nullptr),
+			growth_trigger_(nullptr),
+			next_start_(nullptr),
+			next_capacity_(0),
+			watermark_(watermark)
+			{
+				assert(watermark > 0 && watermark < 1 && "watermark out of range");
+			};
+
+		pregrow_vector(const pregrow_vector&) = delete;
+		pregrow_vector& operator=(const pregrow_vector&) = delete;
+
+		pregrow_vector(pregrow_vector&& x) :
+			pregrow_vector(x.watermark_)
+			{
+				swap(x);
+			};
+
+		pregrow_vector& operator=(pregrow_vector&& x){
+			swap(x);
+			return *this;
+		}
+
+		~pregrow_vector(){
+			settle();
+			destroy_elements(array_start_, array_end_);
+			deallocate(array_start_);
+		}
+
+		/**
+		 * @brief      Swaps the contents, after ending any growth in flight in either vector.
+		 */
+		void swap(pregrow_vector& x){
+			settle();
+			x.settle();
+			using std::swap;
+			swap(array_start_, x.array_start_);
+			swap(array_end_, x.array_end_);
+			swap(array_range_end_, x.array_range_end_);
+			swap(growth_trigger_, x.growth_trigger_);
+			swap(watermark_, x.watermark_);
+		}
+
+		/**
+		 * @brief      Checks whether a background growth is in flight.
+		 */
+		inline bool growing() const {return next_start_ != nullptr;}
+
+		// Iterators
+
+		inline iterator begin(){settle(); return array_start_;}
+		inline iterator end(){settle(); return array_end_;}
+		inline const_iterator begin() const {return array_start_;}
+		inline const_iterator end() const {return array_end_;}
+		inline const_iterator cbegin() const {return array_start_;}
+		inline const_iterator cend() const {return array_end_;}
+
+		// Capacity
+
+		inline size_type size() const {return array_end_ - array_start_;}
+		inline bool empty() const {return array_end_ == array_start_;}
+		inline size_type capacity() const {return array_range_end_ - array_start_;}
+
+		/**
+		 * @brief      Grows to at least n elements on the spot.
+		 */
+		void reserve(size_type n){
+			settle();
+			if (n > capacity())
+				grow_now(n);
+		}
+
+		// Element access
+
+		inline reference operator[](size_type n){settle(); return array_start_[n];}
+		inline const_reference operator[](size_type n) const {return array_start_[n];}
+
+		reference at(size_type n){
+			if (n < size())
+				return (*this)[n];
+			else throw std::out_of_range("out of vector range.");
+		}
+
+		const_reference at(size_type n) const {
+			if (n < size())
+				return array_start_[n];
+			else throw std::out_of_range("out of vector range.");
+		}
+
+		inline reference front(){settle(); return *array_start_;}
+		inline const_reference front() const {return *array_start_;}
+		inline reference back(){settle(); return *(array_end_ - 1);}
+		inline const_reference back() const {return *(array_end_ - 1);}
+		inline pointer data(){settle(); return array_start_;}
+		inline const_pointer data() const {return array_start_;}
+
+		// Modifiers
+
+		void push_back(const value_type& val){
+			emplace_back(val);
+		}
+
+		void push_back(value_type&& val){
+			emplace_back(std::move(val));
+		}
+
+		/**
+		 * @brief      Constructs an element at the end, and copies it to the next array while a growth is in flight.
+		 * Pointers and references to elements are invalidated when the vector switches arrays.
+		 *
+		 * @param[in]  args       Arguments to forward to the constructor of the element
+		 *
+		 * @tparam     Args       Arguments template
+		 */
+		template <class... Args>
+		void emplace_back(Args&&... args){
+			if (__builtin_expect(array_end_ == growth_trigger_, 0) && (next_start_ || capacity() * sizeof(T) < min_background_bytes)){
+				// the elements are about to move and args may refer to one of them
+				T value(std::forward<Args>(args)...);
+				advance_growth();
+				::new(static_cast<void*>(array_end_)) T(std::move(value));
+			} else {
+				if (__builtin_expect(array_end_ == growth_trigger_, 0))
+					advance_growth();
+				::new(static_cast<void*>(array_end_)) T(std::forward<Args>(args)...);
+			}
+			if (next_start_)
+				std::memcpy(static_cast<void*>(next_start_ + size()), static_cast<const void*>(array_end_), sizeof(T));
+			++array_end_;
+		}
+
+		void pop_back(){
+			settle();
+			--array_end_;
+			array_end_->~T();
+		}
+
+		void clear(){
+			settle();
+			destroy_elements(array_start_, array_end_);
+			array_end_ = array_start_;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,1127 @@
+#ifndef FAKESIMD_H
+#define FAKESIMD_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <immintrin.h>
+
+namespace fake{
+	namespace simd{
+		/**
+		 * @brief      Instruction set levels the kernels are compiled for.
+		 */
+		enum class isa{
+			scalar,
+			sse2,
+			avx2,
+			avx512
+		};
+
+		/**
+		 * @brief      Detects the best instruction set supported by the running CPU. The result is cached after the first call.
+		 *
+		 * @return     Instruction set level.
+		 */
+		inline isa detected_isa(){
+			static const isa level = [](){
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+					return isa::avx512;
+				if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt"))
+					return isa::avx2;
+				if (__builtin_cpu_supports("sse2"))
+					return isa::sse2;
+				return isa::scalar;
+			}();
+			return level;
+		}
+
+		namespace detail{
+			inline std::atomic<isa>& isa_limit(){
+				static std::atomic<isa> limit(isa::avx512);
+				return limit;
+			}
+		}
+
+		/**
+		 * @brief      Caps the instruction set the kernels dispatch to, for benchmarking the narrower kernels or avoiding
+		 * AVX-512 clock penalties. Kernels already running are not affected.
+		 *
+		 * @param[in]  level  Highest level to use
+		 */
+		inline void limit_isa(isa level){
+			detail::isa_limit().store(level, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief      Instruction set the kernels dispatch to: the detected one, capped by limit_isa.
+		 *
+		 * @return     Instruction set level.
+		 */
+		inline isa active_isa(){
+			const isa limit = detail::isa_limit().load(std::memory_order_relaxed);
+			const isa level = detected_isa();
+			return limit < level ? limit : level;
+		}
+
+		/**
+		 * @brief      Checks whether the kernels can treat T as a plain 32 or 64 bit lane.
+		 *
+		 * @tparam     T     Element type
+		 */
+		template <class T>
+		struct is_lane_type : std::integral_constant<bool,
+			std::is_arithmetic<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)> {};
+
+		namespace detail{
+			/**
+			 * @brief      Unsigned integer of the same width as T, used to move lanes around as raw bits.
+			 */
+			template <std::size_t Size> struct lane_bits;
+			template <> struct lane_bits<4> { typedef std::uint32_t type; };
+			template <> struct lane_bits<8> { typedef std::uint64_t type; };
+
+			/**
+			 * @brief      Moves the elements of src whose bit in keep is set to dst, keeping their order.
+			 * dst may alias src as long as dst <= src.
+			 *
+			 * @param      dst    Destination
+			 * @param[in]  src    Source, count elements
+			 * @param[in]  keep   Bit i set keeps src[i]
+			 * @param[in]  count  Number of elements, at most 64
+			 *
+			 * @return     Number of elements written.
+			 */
+			template <class T>
+			inline std::size_t compress_block_scalar(T* dst, T* src, std::uint64_t keep, std::size_t count){
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < count; ++i){
+					if ((keep >> i) & 1){
+						if (dst + out != src + i)
+							dst[out] = std::move(src[i]);
+						++out;
+					}
+				}
+				return out;
+			}
+
+			/**
+			 * @brief      compress_block_scalar for raw lanes. Copies the bits with memcpy so the lanes may hold floating point values.
+			 */
+			template <class Bits>
+			inline std::size_t compress_block_bits(Bits* dst, Bits* src, std::uint64_t keep, std::size_t count){
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < count; ++i){
+					if ((keep >> i) & 1){
+						std::memcpy(dst + out, src + i, sizeof(Bits));
+						++out;
+					}
+				}
+				return out;
+			}
+
+			/**
+			 * @brief      Permutes the kept 32 bit lanes of v to the front. The lane indices are built
+			 * from the 8 bit mask with pdep/pext instead of a lookup table.
+			 */
+			[[gnu::target("avx2,bmi2")]]
+			inline __m256i compress_lanes_avx2(__m256i v, unsigned int mask8){
+				const std::uint64_t expanded = _pdep_u64(mask8, 0x0101010101010101ull) * 0xFF;
+				const std::uint64_t wanted = _pext_u64(0x0706050403020100ull, expanded);
+				const __m256i indices = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(wanted));
+				return _mm256_permutevar8x32_epi32(v, indices);
+			}
+
+			[[gnu::target("avx2,bmi2,popcnt")]]
+			inline std::size_t compress_block_avx2(std::uint32_t* dst, std::uint32_t* src, std::uint64_t keep, std::size_t count){
+				if (count != 64)
+					return compress_block_bits(dst, src, keep, count);
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < 64; i += 8){
+					const unsigned int mask = (keep >> i) & 0xFF;
+					const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + out), compress_lanes_avx2(v, mask));
+					out += _mm_popcnt_u32(mask);
+				}
+				return out;
+			}
+
+			[[gnu::target("avx2,bmi2,popcnt")]]
+			inline std::size_t compress_block_avx2(std::uint64_t* dst, std::uint64_t* src, std::uint64_t keep, std::size_t count){
+				if (count != 64)
+					return compress_block_bits(dst, src, keep, count);
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < 64; i += 4){
+					// every 64 bit lane is a pair of 32 bit lanes
+					const unsigned int mask = _pdep_u32((keep >> i) & 0xF, 0x55) * 3;
+					const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + out), compress_lanes_avx2(v, mask));
+					out += _mm_popcnt_u32(mask) / 2;
+				}
+				return out;
+			}
+
+			[[gnu::target("avx512f,popcnt")]]
+			inline std::size_t compress_block_avx512(std::uint32_t* dst, std::uint32_t* src, std::uint64_t keep, std::size_t count){
+				if (count != 64)
+					return compress_block_bits(dst, src, keep, count);
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < 64; i += 16){
+					const __mmask16 mask = (keep >> i) & 0xFFFF;
+					_mm512_mask_compressstoreu_epi32(dst + out, mask, _mm512_loadu_si512(src + i));
+					out += _mm_popcnt_u32(mask);
+				}
+				return out;
+			}
+
+			[[gnu::target("avx512f,popcnt")]]
+			inline std::size_t compress_block_avx512(std::uint64_t* dst, std::uint64_t* src, std::uint64_t keep, std::size_t count){
+				if (count != 64)
+					return compress_block_bits(dst, src, keep, count);
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < 64; i += 8){
+					const __mmask8 mask = (keep >> i) & 0xFF;
+					_mm512_mask_compressstoreu_epi64(dst + out, mask, _mm512_loadu_si512(src + i));
+					out += _mm_popcnt_u32(mask);
+				}
+				return out;
+			}
+
+			/**
+			 * @brief      Compacts lanes in place block by block. The loop is instantiated once per instruction set
+			 * so the mask source gets inlined and vectorized together with the kernel.
+			 */
+			template <class Bits, class MaskSource>
+			inline std::size_t compact_lanes_scalar(Bits* data, std::size_t n, MaskSource& masks){
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < n; i += 64){
+					const std::size_t count = n - i < 64 ? n - i : 64;
+					out += compress_block_bits(data + out, data + i, masks(i, count), count);
+				}
+				return out;
+			}
+
+			template <class Bits, class MaskSource>
+			[[gnu::target("avx2,bmi2,popcnt")]]
+			inline std::size_t compact_lanes_avx2(Bits* data, std::size_t n, MaskSource& masks){
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < n; i += 64){
+					const std::size_t count = n - i < 64 ? n - i : 64;
+					out += compress_block_avx2(data + out, data + i, masks(i, count), count);
+				}
+				return out;
+			}
+
+			template <class Bits, class MaskSource>
+			[[gnu::target("avx512f,avx512bw,avx512vl,bmi2,popcnt")]]
+			inline std::size_t compact_lanes_avx512(Bits* data, std::size_t n, MaskSource& masks){
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < n; i += 64){
+					const std::size_t count = n - i < 64 ? n - i : 64;
+					out += compress_block_avx512(data + out, data + i, masks(i, count), count);
+				}
+				return out;
+			}
+
+			/**
+			 * @brief      Compacts lanes in place, picking the widest kernel the CPU supports.
+			 */
+			template <class Bits, class MaskSource>
+			inline std::size_t compact_lanes(Bits* data, std::size_t n, MaskSource& masks){
+				switch (active_isa()){
+					case isa::avx512: return compact_lanes_avx512(data, n, masks);
+					case isa::avx2: return compact_lanes_avx2(data, n, masks);
+					default: return compact_lanes_scalar(data, n, masks);
+				}
+			}
+
+			template <class T, class MaskSource>
+			inline std::size_t compact(T* data, std::size_t n, MaskSource& masks, std::true_type){
+				typedef typename lane_bits<sizeof(T)>::type bits;
+				return compact_lanes(reinterpret_cast<bits*>(data), n, masks);
+			}
+
+			template <class T, class MaskSource>
+			inline std::size_t compact(T* data, std::size_t n, MaskSource& masks, std::false_type){
+				std::size_t out = 0;
+				for (std::size_t i = 0; i < n; i += 64){
+					const std::size_t count = n - i < 64 ? n - i : 64;
+					out += compress_block_scalar(data + out, data + i, masks(i, count), count);
+				}
+				return out;
+			}
+		}
+
+		namespace detail{
+			/**
+			 * @brief      GCC vector extension type of Bytes bytes holding lanes of T. Arithmetic, comparisons and ?: on it
+			 * work lane by lane and compile to whatever instruction set the enclosing function is built for.
+			 */
+			template <class T, std::size_t Bytes>
+			struct vector_of{
+				typedef T type __attribute__((vector_size(Bytes)));
+				typedef T unaligned __attribute__((vector_size(Bytes), aligned(alignof(T)), may_alias));
+			};
+
+			/**
+			 * @brief      Unaligned load. Writes through a reference, returning wide vectors by value changes the ABI.
+			 */
+			template <class V, class T>
+			[[gnu::always_inline]] inline void load(V& v, const T* source){
+				v = *reinterpret_cast<const typename vector_of<T, sizeof(V)>::unaligned*>(source);
+			}
+
+			/**
+			 * @brief      Unaligned store.
+			 */
+			template <class V, class T>
+			[[gnu::always_inline]] inline void store(T* destination, const V& v){
+				*reinterpret_cast<typename vector_of<T, sizeof(V)>::unaligned*>(destination) = v;
+			}
+
+			/**
+			 * @brief      Checks whether any lane of a mask vector is set. Written with vector extensions rather than
+			 * intrinsics so it compiles in every target, it reduces to a test instruction once inlined.
+			 */
+			template <class M>
+			[[gnu::always_inline]] inline bool any_lane(const M& mask){
+				typedef typename vector_of<unsigned long long, sizeof(M)>::type W;
+				const W words = (W)mask;
+				unsigned long long bits = 0;
+				for (std::size_t j = 0; j < sizeof(M) / 8; ++j)
+					bits |= words[j];
+				return bits != 0;
+			}
+
+			/**
+			 * @brief      Runs Kernel::run<Bytes> inside a function compiled for the matching instruction set.
+			 * The kernels are always_inline, so they pick up the target of the wrapper they end up in.
+			 */
+			template <class Kernel, class... Args>
+			inline auto run_sse2(Args... args){return Kernel::template run<16>(args...);}
+
+			template <class Kernel, class... Args>
+			[[gnu::target("avx2,bmi2,popcnt")]]
+			inline auto run_avx2(Args... args){return Kernel::template run<32>(args...);}
+
+			template <class Kernel, class... Args>
+			[[gnu::target("avx512f,avx512bw,avx512vl,bmi2,popcnt")]]
+			inline auto run_avx512(Args... args){return Kernel::template run<64>(args...);}
+
+			template <class Kernel, class... Args>
+			inline auto dispatch(Args... args){
+				switch (active_isa()){
+					case isa::avx512: return run_avx512<Kernel>(args...);
+					case isa::avx2: return run_avx2<Kernel>(args...);
+					default: return run_sse2<Kernel>(args...);
+				}
+			}
+
+			/**
+			 * @brief      Index of the first lane equal to any of the needles, n if there is none.
+			 * Four vectors are tested per iteration, the matching block is then scanned one lane at a time. The vectors are
+			 * at most 32 bytes wide, GCC scalarizes the or of several 64 byte compares.
+			 */
+			template <class T>
+			struct find_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline std::size_t run(const T* data, std::size_t n, const T* needles, std::size_t needle_count){
+					typedef typename vector_of<T, (Bytes > 32 ? 32 : Bytes)>::type V;
+					typedef decltype(V{} == V{}) M;
+					const M ones = M{} - 1;
+					const std::size_t lanes = sizeof(V) / sizeof(T);
+					std::size_t i = 0;
+					for (; i + 4*lanes <= n; i += 4*lanes){
+						V a, b, c, d;
+						load(a, data + i);
+						load(b, data + i + lanes);
+						load(c, data + i + 2*lanes);
+						load(d, data + i + 3*lanes);
+						V needle = V{} + needles[0];
+						M match = (a == needle ? ones : M{}) | (b == needle ? ones : M{}) | (c == needle ? ones : M{}) | (d == needle ? ones : M{});
+						for (std::size_t k = 1; k < needle_count; ++k){
+							needle = V{} + needles[k];
+							match |= (a == needle ? ones : M{}) | (b == needle ? ones : M{}) | (c == needle ? ones : M{}) | (d == needle ? ones : M{});
+						}
+						if (any_lane(match))
+							break;
+					}
+					for (; i < n; ++i)
+						for (std::size_t k = 0; k < needle_count; ++k)
+							if (data[i] == needles[k])
+								return i;
+					return n;
+				}
+			};
+
+			/**
+			 * @brief      Index of the last lane equal to needle, n if there is none.
+			 */
+			template <class T>
+			struct find_last_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline std::size_t run(const T* data, std::size_t n, T value){
+					typedef typename vector_of<T, (Bytes > 32 ? 32 : Bytes)>::type V;
+					typedef decltype(V{} == V{}) M;
+					const M ones = M{} - 1;
+					const std::size_t lanes = sizeof(V) / sizeof(T);
+					const V needle = V{} + value;
+					std::size_t i = n;
+					for (; i >= 4*lanes; i -= 4*lanes){
+						const T* block = data + i - 4*lanes;
+						V a, b, c, d;
+						load(a, block);
+						load(b, block + lanes);
+						load(c, block + 2*lanes);
+						load(d, block + 3*lanes);
+						if (any_lane((a == needle ? ones : M{}) | (b == needle ? ones : M{}) | (c == needle ? ones : M{}) | (d == needle ? ones : M{})))
+							break;
+					}
+					while (i-- > 0)
+						if (data[i] == value)
+							return i;
+					return n;
+				}
+			};
+
+			/**
+			 * @brief      Number of lanes equal to needle. The lane counters are flushed often enough not to overflow.
+			 */
+			template <class T>
+			struct count_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline std::size_t run(const T* data, std::size_t n, T value){
+					typedef typename vector_of<T, Bytes>::type V;
+					typedef decltype(V{} == V{}) M;
+					const std::size_t lanes = Bytes / sizeof(T);
+					const std::size_t flush = lanes * (std::size_t(1) << 24);
+					const V needle = V{} + value;
+					std::size_t total = 0;
+					std::size_t i = 0;
+					while (i + lanes <= n){
+						const std::size_t stop = n - i > flush ? i + flush : n;
+						M counts = M{};
+						for (; i + lanes <= stop; i += lanes){
+							V v;
+							load(v, data + i);
+							counts -= (v == needle);
+						}
+						for (std::size_t j = 0; j < lanes; ++j)
+							total += counts[j];
+					}
+					for (; i < n; ++i)
+						total += data[i] == value;
+					return total;
+				}
+			};
+
+			/**
+			 * @brief      Smallest and largest lane. Reports unordered if a NaN was seen, the result is meaningless then.
+			 */
+			template <class T>
+			struct minmax_kernel{
+				struct result{
+					T min;
+					T max;
+					bool unordered;
+				};
+
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline result run(const T* data, std::size_t n){
+					typedef typename vector_of<T, Bytes>::type V;
+					typedef decltype(V{} == V{}) M;
+					const std::size_t lanes = Bytes / sizeof(T);
+					result r = {data[0], data[0], data[0] != data[0]};
+					std::size_t i = 0;
+					if (n >= lanes){
+						V low;
+						load(low, data);
+						V high = low;
+						M nan = low != low;
+						for (i = lanes; i + lanes <= n; i += lanes){
+							V v;
+							load(v, data + i);
+							low = v < low ? v : low;
+							high = v > high ? v : high;
+							nan |= v != v;
+						}
+						r.min = low[0];
+						r.max = high[0];
+						for (std::size_t j = 0; j < lanes; ++j){
+							r.min = low[j] < r.min ? low[j] : r.min;
+							r.max = high[j] > r.max ? high[j] : r.max;
+							r.unordered |= nan[j] != 0;
+						}
+					}
+					for (; i < n; ++i){
+						r.min = data[i] < r.min ? data[i] : r.min;
+						r.max = data[i] > r.max ? data[i] : r.max;
+						r.unordered |= data[i] != data[i];
+					}
+					return r;
+				}
+			};
+
+			/**
+			 * @brief      y += a * x. Multiplies and adds separately, so results match the scalar loop bit for bit.
+			 */
+			template <class T>
+			struct axpy_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline void run(T a, const T* x, T* y, std::size_t n){
+					typedef typename vector_of<T, Bytes>::type V;
+					const std::size_t lanes = Bytes / sizeof(T);
+					const V factor = V{} + a;
+					std::size_t i = 0;
+					for (; i + lanes <= n; i += lanes){
+						V vx, vy;
+						load(vx, x + i);
+						load(vy, y + i);
+						vy += factor * vx;
+						store(y + i, vy);
+					}
+					for (; i < n; ++i)
+						y[i] += a * x[i];
+				}
+			};
+
+			/**
+			 * @brief      Sum of x[i] * y[i], or of x[i] when y is null. Two vector accumulators hide the add latency,
+			 * floating point results can differ from a sequential sum in the last bits.
+			 */
+			template <class T>
+			struct dot_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline T run(const T* x, const T* y, std::size_t n){
+					typedef typename vector_of<T, Bytes>::type V;
+					const std::size_t lanes = Bytes / sizeof(T);
+					V first = V{}, second = V{};
+					std::size_t i = 0;
+					if (y){
+						for (; i + 2*lanes <= n; i += 2*lanes){
+							V a, b, c, d;
+							load(a, x + i);
+							load(b, x + i + lanes);
+							load(c, y + i);
+							load(d, y + i + lanes);
+							first += a * c;
+							second += b * d;
+						}
+					} else {
+						for (; i + 2*lanes <= n; i += 2*lanes){
+							V a, b;
+							load(a, x + i);
+							load(b, x + i + lanes);
+							first += a;
+							second += b;
+						}
+					}
+					first += second;
+					T total = T();
+					for (std::size_t j = 0; j < lanes; ++j)
+						total += first[j];
+					for (; i < n; ++i)
+						total += y ? x[i] * y[i] : x[i];
+					return total;
+				}
+			};
+
+			/**
+			 * @brief      In-register inclusive scan of v: adds v shifted up by Shift, 2 * Shift, ... lanes. Unrolled at
+			 * compile time so every shuffle gets a constant lane mask.
+			 */
+			template <std::size_t Shift, std::size_t Lanes>
+			struct scan_steps{
+				template <class V, class I>
+				[[gnu::always_inline]] static inline void apply(V& v){
+					I lane_from;
+					for (std::size_t j = 0; j < Lanes; ++j)
+						lane_from[j] = j >= Shift ? j - Shift : Lanes + j;
+					v += __builtin_shuffle(v, V{}, lane_from);
+					scan_steps<2 * Shift, Lanes>::template apply<V, I>(v);
+				}
+			};
+
+			template <std::size_t Lanes>
+			struct scan_steps<Lanes, Lanes>{
+				template <class V, class I>
+				[[gnu::always_inline]] static inline void apply(V&){}
+			};
+
+			/**
+			 * @brief      Prefix sum starting from carry, out may be in. Each vector is scanned in log2(lanes) shift and
+			 * add steps, then offset by the running total. The exclusive scan shifts the scanned vector up one more lane,
+			 * so both variants add the elements in the same order.
+			 *
+			 * @return     carry plus the sum of all the elements.
+			 */
+			template <class T, bool Exclusive = false>
+			struct prefix_sum_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline T run(const T* in, T* out, std::size_t n, T carry){
+					typedef typename vector_of<T, Bytes>::type V;
+					typedef typename vector_of<typename lane_bits<sizeof(T)>::type, Bytes>::type I;
+					static const std::size_t lanes = Bytes / sizeof(T);
+					std::size_t i = 0;
+					for (; i + lanes <= n; i += lanes){
+						V v;
+						load(v, in + i);
+						scan_steps<1, lanes>::template apply<V, I>(v);
+						if (Exclusive){
+							I lane_from;
+							for (std::size_t j = 0; j < lanes; ++j)
+								lane_from[j] = j >= 1 ? j - 1 : lanes;
+							store(out + i, __builtin_shuffle(v, V{}, lane_from) + carry);
+							carry += v[lanes - 1];
+						} else {
+							v += carry;
+							store(out + i, v);
+							carry = v[lanes - 1];
+						}
+					}
+					for (; i < n; ++i){
+						const T value = in[i];
+						out[i] = Exclusive ? carry : carry + value;
+						carry += value;
+					}
+					return carry;
+				}
+			};
+
+			/**
+			 * @brief      Clamps every element to [low, high]. NaNs are left as they are, like std::clamp.
+			 */
+			template <class T>
+			struct clamp_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline void run(const T* in, T* out, std::size_t n, T low, T high){
+					typedef typename vector_of<T, Bytes>::type V;
+					const std::size_t lanes = Bytes / sizeof(T);
+					const V lower = V{} + low, upper = V{} + high;
+					std::size_t i = 0;
+					for (; i + lanes <= n; i += lanes){
+						V v;
+						load(v, in + i);
+						v = v < lower ? lower : v;
+						v = v > upper ? upper : v;
+						store(out + i, v);
+					}
+					for (; i < n; ++i)
+						out[i] = in[i] < low ? low : in[i] > high ? high : in[i];
+				}
+			};
+
+			/**
+			 * @brief      static_cast of every element. The lane count is set by the wider of the two types.
+			 */
+			template <class From, class To>
+			struct convert_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline void run(const From* in, To* out, std::size_t n){
+					const std::size_t lanes = Bytes / (sizeof(From) > sizeof(To) ? sizeof(From) : sizeof(To));
+					typedef typename vector_of<From, lanes * sizeof(From)>::type VF;
+					typedef typename vector_of<To, lanes * sizeof(To)>::type VT;
+					std::size_t i = 0;
+					for (; i + lanes <= n; i += lanes){
+						VF v;
+						load(v, in + i);
+						store(out + i, __builtin_convertvector(v, VT));
+					}
+					for (; i < n; ++i)
+						out[i] = static_cast<To>(in[i]);
+				}
+			};
+
+			/**
+			 * @brief      Adds the number of floating point elements falling in each of bins equal-width bins over [low, high]
+			 * to counts. Elements outside the range and NaNs are skipped. Bin indices are computed a vector at a time into a
+			 * block and counted afterwards, reading lanes straight out of the vectors stalls on store forwarding. Up to 256 bins
+			 * are counted in four interleaved tables with an extra bin for skipped elements, so the counting loop has no
+			 * branches and repeated values do not wait on the same counter. Vectors are at most 32 bytes, as for find.
+			 */
+			template <class T>
+			struct histogram_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline void run(const T* data, std::size_t n, T low, T high, std::size_t* counts, std::size_t bins){
+					typedef typename vector_of<T, (Bytes > 32 ? 32 : Bytes)>::type V;
+					typedef typename std::make_signed<typename lane_bits<sizeof(T)>::type>::type index;
+					typedef typename vector_of<index, sizeof(V)>::type I;
+					const std::size_t lanes = sizeof(V) / sizeof(T);
+					const std::size_t block_size = 256;
+					const bool interleave = bins <= 256;
+					const std::size_t stride = bins + 1;
+					index block[block_size];
+					std::size_t tables[4 * 257];
+					if (interleave)
+						std::fill(tables, tables + 4 * stride, std::size_t(0));
+					const T scale = T(bins) / (high - low);
+					const V lower = V{} + low, upper = V{} + high, factor = V{} + scale;
+					const I last = I{} + index(bins - 1), skip = I{} + index(bins);
+					std::size_t i = 0;
+					for (; i + block_size <= n; i += block_size){
+						for (std::size_t k = 0; k < block_size; k += lanes){
+							V v;
+							load(v, data + i + k);
+							I bin = __builtin_convertvector((v - lower) * factor, I);
+							bin = bin > last ? last : bin;
+							bin = (v >= lower) & (v <= upper) ? bin : skip;
+							store(block + k, bin);
+						}
+						if (interleave){
+							for (std::size_t j = 0; j < block_size; j += 4){
+								++tables[block[j]];
+								++tables[stride + block[j + 1]];
+								++tables[2*stride + block[j + 2]];
+								++tables[3*stride + block[j + 3]];
+							}
+						} else {
+							for (std::size_t j = 0; j < block_size; ++j)
+								if (std::size_t(block[j]) != bins)
+									++counts[block[j]];
+						}
+					}
+					for (; i < n; ++i){
+						if (data[i] >= low && data[i] <= high){
+							const std::size_t bin = static_cast<std::size_t>((data[i] - low) * scale);
+							++counts[bin < bins ? bin : bins - 1];
+						}
+					}
+					if (interleave)
+						for (std::size_t w = 0; w < 4; ++w)
+							for (std::size_t b = 0; b < bins; ++b)
+								counts[b] += tables[w * stride + b];
+				}
+			};
+
+			/**
+			 * @brief      Integer histogram, exact: element x goes to bin (x - low) * bins / (high - low + 1).
+			 */
+			template <class T>
+			inline void histogram_integral(const T* data, std::size_t n, T low, T high, std::size_t* counts, std::size_t bins){
+				typedef typename std::make_unsigned<T>::type U;
+				const unsigned __int128 range = (unsigned __int128)(U(U(high) - U(low))) + 1;
+				const std::size_t ways = bins <= 256 ? 4 : 1;
+				std::size_t interleaved[4 * 256];
+				std::size_t* const tables = ways == 4 ? interleaved : counts;
+				const std::size_t stride = ways == 4 ? bins : 0;
+				if (ways == 4)
+					std::fill(interleaved, interleaved + 4 * bins, std::size_t(0));
+				for (std::size_t i = 0; i < n; ++i)
+					if (data[i] >= low && data[i] <= high)
+						++tables[(i & 3) * stride + std::size_t((unsigned __int128)(U(U(data[i]) - U(low))) * bins / range)];
+				if (ways == 4)
+					for (std::size_t w = 0; w < 4; ++w)
+						for (std::size_t b = 0; b < bins; ++b)
+							counts[b] += interleaved[w * bins + b];
+			}
+
+			template <class T>
+			inline void histogram(const T* data, std::size_t n, T low, T high, std::size_t* counts, std::size_t bins, std::true_type){
+				dispatch<histogram_kernel<T>>(data, n, low, high, counts, bins);
+			}
+
+			template <class T>
+			inline void histogram(const T* data, std::size_t n, T low, T high, std::size_t* counts, std::size_t bins, std::false_type){
+				histogram_integral(data, n, low, high, counts, bins);
+			}
+
+			/**
+			 * @brief      Loads the elements of table at one vector of indices into out. SSE2 has no gather instruction,
+			 * the lanes are loaded one by one. Hardware gathers sign extend 32 bit indices.
+			 */
+			template <class Bits>
+			[[gnu::always_inline]] inline void gather_lanes(Bits* out, const Bits* table, const Bits* indices, std::integral_constant<std::size_t, 16>){
+				for (std::size_t k = 0; k < 16 / sizeof(Bits); ++k)
+					out[k] = table[indices[k]];
+			}
+
+			[[gnu::target("avx2")]]
+			inline void gather_lanes(std::uint32_t* out, const std::uint32_t* table, const std::uint32_t* indices, std::integral_constant<std::size_t, 32>){
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), v, 4));
+			}
+
+			[[gnu::target("avx2")]]
+			inline void gather_lanes(std::uint64_t* out, const std::uint64_t* table, const std::uint64_t* indices, std::integral_constant<std::size_t, 32>){
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_i64gather_epi64(reinterpret_cast<const long long*>(table), v, 8));
+			}
+
+			[[gnu::target("avx512f")]]
+			inline void gather_lanes(std::uint32_t* out, const std::uint32_t* table, const std::uint32_t* indices, std::integral_constant<std::size_t, 64>){
+				// The masked form with a zero source, the unmasked one trips -Wmaybe-uninitialized in GCC's header.
+				_mm512_storeu_si512(out, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, _mm512_loadu_si512(indices), table, 4));
+			}
+
+			[[gnu::target("avx512f")]]
+			inline void gather_lanes(std::uint64_t* out, const std::uint64_t* table, const std::uint64_t* indices, std::integral_constant<std::size_t, 64>){
+				_mm512_storeu_si512(out, _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), 0xFF, _mm512_loadu_si512(indices), table, 8));
+			}
+
+			/**
+			 * @brief      out[i] = table[indices[i]], a vector of indices at a time. With a non-zero distance the table
+			 * elements of the vector of indices distance elements ahead are prefetched as a group, so several cache misses
+			 * are in flight while the current vector is gathered.
+			 */
+			template <class T, class Index>
+			struct gather_kernel{
+				template <std::size_t Bytes>
+				[[gnu::always_inline]] static inline void run(const T* table, const Index* indices, std::size_t n, T* out, std::size_t distance){
+					typedef typename lane_bits<sizeof(T)>::type bits;
+					const std::size_t lanes = Bytes / sizeof(T);
+					const bits* table_bits = reinterpret_cast<const bits*>(table);
+					const bits* index_bits = reinterpret_cast<const bits*>(indices);
+					bits* out_bits = reinterpret_cast<bits*>(out);
+					const std::size_t vector_end = n - n % lanes;
+					std::size_t i = 0;
+					for (; i < vector_end; i += lanes){
+						if (distance != 0 && i + distance + lanes <= n)
+							for (std::size_t k = 0; k < lanes; ++k)
+								__builtin_prefetch(table + indices[i + distance + k]);
+						gather_lanes(out_bits + i, table_bits, index_bits + i, std::integral_constant<std::size_t, Bytes>());
+					}
+					for (; i < n; ++i)
+						out[i] = table[indices[i]];
+				}
+			};
+
+
+			/**
+			 * @brief      IEEE binary32 to binary16 bits, rounding to nearest even. NaNs become the canonical quiet NaN.
+			 */
+			inline std::uint16_t float_to_half_bits(float value){
+				std::uint32_t x;
+				std::memcpy(&x, &value, sizeof(x));
+				const std::uint32_t sign = x & 0x80000000u;
+				x ^= sign;
+				std::uint16_t half;
+				if (x >= (127u + 16) << 23){
+					half = x > 0x7f800000u ? 0x7e00 : 0x7c00;
+				} else if (x < 113u << 23){
+					// subnormal or zero, let the FPU round the shifted out bits
+					const std::uint32_t magic_bits = ((127u - 15) + (23 - 10) + 1) << 23;
+					float magic, shifted;
+					std::memcpy(&magic, &magic_bits, sizeof(magic));
+					std::memcpy(&shifted, &x, sizeof(shifted));
+					shifted += magic;
+					std::uint32_t bits;
+					std::memcpy(&bits, &shifted, sizeof(bits));
+					half = bits - magic_bits;
+				} else {
+					const std::uint32_t odd = (x >> 13) & 1;
+					x += ((15u - 127) << 23) + 0xfff + odd;
+					half = x >> 13;
+				}
+				return half | (sign >> 16);
+			}
+
+			/**
+			 * @brief      IEEE binary16 bits to binary32, exact except that signaling NaNs are quieted.
+			 */
+			inline float half_to_float_bits(std::uint16_t half){
+				const std::uint32_t sign = std::uint32_t(half & 0x8000) << 16;
+				const std::uint32_t exponent = (half >> 10) & 0x1f;
+				const std::uint32_t mantissa = half & 0x3ff;
+				float value;
+				if (exponent == 0){
+					value = mantissa * 5.9604644775390625e-8f;
+					std::uint32_t bits;
+					std::memcpy(&bits, &value, sizeof(bits));
+					bits |= sign;
+					std::memcpy(&value, &bits, sizeof(value));
+				} else {
+					// infinities keep a zero mantissa, NaNs are quieted like the hardware conversion does
+					const std::uint32_t bits = sign | (exponent == 0x1f ? 0x7f800000u | (mantissa ? 0x400000u : 0) : (exponent + 112) << 23) | (mantissa << 13);
+					std::memcpy(&value, &bits, sizeof(value));
+				}
+				return value;
+			}
+
+			inline void float_to_half_scalar(const float* in, std::uint16_t* out, std::size_t n){
+				for (std::size_t i = 0; i < n; ++i)
+					out[i] = float_to_half_bits(in[i]);
+			}
+
+			inline void half_to_float_scalar(const std::uint16_t* in, float* out, std::size_t n){
+				for (std::size_t i = 0; i < n; ++i)
+					out[i] = half_to_float_bits(in[i]);
+			}
+
+			[[gnu::target("avx2,f16c")]]
+			inline void float_to_half_f16c(const float* in, std::uint16_t* out, std::size_t n){
+				std::size_t i = 0;
+				for (; i + 8 <= n; i += 8)
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+				float_to_half_scalar(in + i, out + i, n - i);
+			}
+
+			[[gnu::target("avx2,f16c")]]
+			inline void half_to_float_f16c(const std::uint16_t* in, float* out, std::size_t n){
+				std::size_t i = 0;
+				for (; i + 8 <= n; i += 8)
+					_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+				half_to_float_scalar(in + i, out + i, n - i);
+			}
+
+			[[gnu::target("avx512f")]]
+			inline void float_to_half_avx512(const float* in, std::uint16_t* out, std::size_t n){
+				std::size_t i = 0;
+				for (; i + 16 <= n; i += 16)
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm512_maskz_cvtps_ph(0xffff, _mm512_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+				float_to_half_scalar(in + i, out + i, n - i);
+			}
+
+			[[gnu::target("avx512f")]]
+			inline void half_to_float_avx512(const std::uint16_t* in, float* out, std::size_t n){
+				std::size_t i = 0;
+				for (; i + 16 <= n; i += 16)
+					_mm512_storeu_ps(out + i, _mm512_maskz_cvtph_ps(0xffff, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i))));
+				half_to_float_scalar(in + i, out + i, n - i);
+			}
+
+			/**
+			 * @brief      The AVX2 level does not imply F16C, it is checked separately.
+			 */
+			inline bool has_f16c(){
+				static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("f16c"));
+				return supported;
+			}
+		}
+
+		/**
+		 * @brief      Finds the first element equal to value.
+		 *
+		 * @param[in]  data   Array to search
+		 * @param[in]  n      Number of elements
+		 * @param[in]  value  Value to look for
+		 *
+		 * @tparam     T      32 or 64 bit arithmetic type
+		 *
+		 * @return     Index of the element, n if there is none.
+		 */
+		template <class T>
+		inline std::size_t find(const T* data, std::size_t n, T value){
+			return detail::dispatch<detail::find_kernel<T>>(data, n, static_cast<const T*>(&value), std::size_t(1));
+		}
+
+		/**
+		 * @brief      Finds the first element equal to any of the needles.
+		 *
+		 * @return     Index of the element, n if there is none.
+		 */
+		template <class T>
+		inline std::size_t find_first_of(const T* data, std::size_t n, const T* needles, std::size_t needle_count){
+			return detail::dispatch<detail::find_kernel<T>>(data, n, needles, needle_count);
+		}
+
+		/**
+		 * @brief      Finds the last element equal to value.
+		 *
+		 * @return     Index of the element, n if there is none.
+		 */
+		template <class T>
+		inline std::size_t find_last(const T* data, std::size_t n, T value){
+			return detail::dispatch<detail::find_last_kernel<T>>(data, n, value);
+		}
+
+		/**
+		 * @brief      Counts the elements equal to value.
+		 *
+		 * @return     Number of matching elements.
+		 */
+		template <class T>
+		inline std::size_t count(const T* data, std::size_t n, T value){
+			return detail::dispatch<detail::count_kernel<T>>(data, n, value);
+		}
+
+		/**
+		 * @brief      Smallest and largest element of a non-empty array.
+		 *
+		 * @return     The values, with unordered set if the array holds a NaN.
+		 */
+		template <class T>
+		inline typename detail::minmax_kernel<T>::result minmax(const T* data, std::size_t n){
+			return detail::dispatch<detail::minmax_kernel<T>>(data, n);
+		}
+
+		/**
+		 * @brief      y[i] += a * x[i] for i in [0, n).
+		 *
+		 * @tparam     T     32 or 64 bit arithmetic type
+		 */
+		template <class T>
+		inline void axpy(T a, const T* x, T* y, std::size_t n){
+			static_assert(is_lane_type<T>::value, "axpy needs 32 or 64 bit arithmetic elements");
+			detail::dispatch<detail::axpy_kernel<T>>(a, x, y, n);
+		}
+
+		/**
+		 * @brief      Dot product of x and y.
+		 */
+		template <class T>
+		inline T dot(const T* x, const T* y, std::size_t n){
+			static_assert(is_lane_type<T>::value, "dot needs 32 or 64 bit arithmetic elements");
+			return detail::dispatch<detail::dot_kernel<T>>(x, y, n);
+		}
+
+		/**
+		 * @brief      Sum of the elements.
+		 */
+		template <class T>
+		inline T sum(const T* data, std::size_t n){
+			static_assert(is_lane_type<T>::value, "sum needs 32 or 64 bit arithmetic elements");
+			return detail::dispatch<detail::dot_kernel<T>>(data, static_cast<const T*>(nullptr), n);
+		}
+
+		/**
+		 * @brief      Inclusive prefix sum, out[i] = carry + in[0] + ... + in[i]. out may be in.
+		 *
+		 * @return     carry plus the sum of all the elements.
+		 */
+		template <class T>
+		inline T prefix_sum(const T* in, T* out, std::size_t n, T carry = T()){
+			static_assert(is_lane_type<T>::value, "prefix_sum needs 32 or 64 bit arithmetic elements");
+			return detail::dispatch<detail::prefix_sum_kernel<T>>(in, out, n, carry);
+		}
+
+		/**
+		 * @brief      Exclusive prefix sum, out[i] = carry + in[0] + ... + in[i - 1]. out may be in.
+		 *
+		 * @return     carry plus the sum of all the elements.
+		 */
+		template <class T>
+		inline T exclusive_prefix_sum(const T* in, T* out, std::size_t n, T carry = T()){
+			static_assert(is_lane_type<T>::value, "exclusive_prefix_sum needs 32 or 64 bit arithmetic elements");
+			return detail::dispatch<detail::prefix_sum_kernel<T, true>>(in, out, n, carry);
+		}
+
+		/**
+		 * @brief      Clamps every element to [low, high]. out may be in.
+		 */
+		template <class T>
+		inline void clamp(const T* in, T* out, std::size_t n, T low, T high){
+			static_assert(is_lane_type<T>::value, "clamp needs 32 or 64 bit arithmetic elements");
+			detail::dispatch<detail::clamp_kernel<T>>(in, out, n, low, high);
+		}
+
+		/**
+		 * @brief      IEEE half precision value, stored as its bits.
+		 */
+		struct half{
+			std::uint16_t bits;
+		};
+
+		/**
+		 * @brief      out[i] = static_cast<To>(in[i]). Floating point to integer conversions of values out of range of To
+		 * are undefined, as they are for static_cast.
+		 */
+		template <class From, class To>
+		inline void convert(const From* in, To* out, std::size_t n){
+			static_assert(std::is_arithmetic<From>::value && std::is_arithmetic<To>::value, "convert needs arithmetic elements");
+			detail::dispatch<detail::convert_kernel<From, To>>(in, out, n);
+		}
+
+		/**
+		 * @brief      Floats to half precision, rounding to nearest even.
+		 */
+		inline void convert(const float* in, half* out, std::size_t n){
+			std::uint16_t* bits = reinterpret_cast<std::uint16_t*>(out);
+			switch (active_isa()){
+				case isa::avx512: return detail::float_to_half_avx512(in, bits, n);
+				case isa::avx2:
+					if (detail::has_f16c())
+						return detail::float_to_half_f16c(in, bits, n);
+					return detail::float_to_half_scalar(in, bits, n);
+				default: return detail::float_to_half_scalar(in, bits, n);
+			}
+		}
+
+		/**
+		 * @brief      Half precision to floats, exact.
+		 */
+		inline void convert(const half* in, float* out, std::size_t n){
+			const std::uint16_t* bits = reinterpret_cast<const std::uint16_t*>(in);
+			switch (active_isa()){
+				case isa::avx512: return detail::half_to_float_avx512(bits, out, n);
+				case isa::avx2:
+					if (detail::has_f16c())
+						return detail::half_to_float_f16c(bits, out, n);
+					return detail::half_to_float_scalar(bits, out, n);
+				default: return detail::half_to_float_scalar(bits, out, n);
+			}
+		}
+
+		/**
+		 * @brief      Adds the number of elements in each of bins equal-width bins over [low, high] to counts.
+		 * Elements outside the range and NaNs are not counted. For integers element x goes to bin
+		 * (x - low) * bins / (high - low + 1), for floating point to floor((x - low) * bins / (high - low)) with high in the last bin.
+		 *
+		 * @param[in]  data    The elements
+		 * @param[in]  n       Number of elements
+		 * @param[in]  low     Lower end of the first bin
+		 * @param[in]  high    Upper end of the last bin, greater than low
+		 * @param      counts  bins counters
+		 * @param[in]  bins    Number of bins
+		 */
+		template <class T>
+		inline void histogram(const T* data, std::size_t n, T low, T high, std::size_t* counts, std::size_t bins){
+			static_assert(is_lane_type<T>::value, "histogram needs 32 or 64 bit arithmetic elements");
+			assert(low < high && bins > 0);
+			detail::histogram(data, n, low, high, counts, bins, std::is_floating_point<T>());
+		}
+
+		/**
+		 * @brief      Checks whether gather can use the SIMD kernels: 32 or 64 bit arithmetic elements and integer
+		 * indices of the same size.
+		 */
+		template <class T, class Index>
+		struct is_gather_type : std::integral_constant<bool,
+			is_lane_type<T>::value && std::is_integral<Index>::value && sizeof(Index) == sizeof(T)> {};
+
+		/**
+		 * @brief      Prefetch distance in elements for gathers and scatters on tables larger than the L2 cache.
+		 */
+		const std::size_t default_prefetch_distance = 64;
+
+		/**
+		 * @brief      out[i] = table[indices[i]] for i in [0, n). AVX2 and AVX-512 use gather instructions.
+		 *
+		 * @param[in]  table     The table
+		 * @param[in]  indices   n indices into table. 32 bit indices must be below 2^31, gathers sign extend them.
+		 * @param[in]  n         Number of indices
+		 * @param      out       Destination for n elements
+		 * @param[in]  distance  How many elements ahead the table is prefetched, 0 for no prefetching
+		 */
+		template <class T, class Index>
+		inline void gather(const T* table, const Index* indices, std::size_t n, T* out, std::size_t distance = 0){
+			static_assert(is_gather_type<T, Index>::value, "gather needs 32 or 64 bit arithmetic elements and integer indices of the same size");
+			detail::dispatch<detail::gather_kernel<T, Index>>(table, indices, n, out, distance);
+		}
+
+		/**
+		 * @brief      Stream compaction. Moves the kept elements of [data, data + n) to the front, keeping their order.
+		 * 32 and 64 bit arithmetic types go through AVX-512 compress stores or AVX2 permutes, everything else is moved one by one.
+		 *
+		 * @param      data        Array to compact in place
+		 * @param[in]  n           Number of elements
+		 * @param      masks       Callable (first, count) returning a word whose bit i keeps data[first + i], count <= 64
+		 *
+		 * @tparam     T           Element type
+		 * @tparam     MaskSource  Callable type
+		 *
+		 * @return     Number of kept elements.
+		 */
+		template <class T, class MaskSource>
+		inline std::size_t compact(T* data, std::size_t n, MaskSource masks){
+			return detail::compact(data, n, masks, is_lane_type<T>());
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef FAKETHREADPOOL_H
+#define FAKETHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "fakeVector.h"
+
+namespace fake{
+	/**
+	 * @brief      Fixed set of worker threads that run the tasks of one parallel_for at a time.
+	 * The calling thread takes part in the work, so a pool of size 1 has no workers and runs everything inline.
+	 */
+	class thread_pool{
+	private:
+		fake::vector<std::thread> workers_;
+		std::mutex call_mutex_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		void (*invoke_)(void*, std::size_t);
+		void* job_;
+		std::size_t task_count_;
+		std::atomic<std::size_t> next_task_;
+		std::size_t running_;
+		unsigned long generation_;
+		std::exception_ptr error_;
+		bool stop_;
+
+		/**
+		 * @brief      Set while a thread is running a task of some pool, nested parallel_for calls then run inline.
+		 */
+		static bool& inside_task(){
+			static thread_local bool inside = false;
+			return inside;
+		}
+
+		template <class Function>
+		static void invoke(void* job, std::size_t task){
+			(*static_cast<Function*>(job))(task);
+		}
+
+		/**
+		 * @brief      Takes tasks until there are none left. The first exception is kept, the rest are dropped.
+		 */
+		void drain(){
+			inside_task() = true;
+			for (std::size_t task; (task = next_task_.fetch_add(1, std::memory_order_relaxed)) < task_count_;){
+				try {
+					invoke_(job_, task);
+				} catch (...) {
+					std::lock_guard<std::mutex> lock(mutex_);
+					if (!error_)
+						error_ = std::current_exception();
+				}
+			}
+			inside_task() = false;
+		}
+
+		void work(){
+			unsigned long seen = 0;
+			std::unique_lock<std::mutex> lock(mutex_);
+			for (;;){
+				wake_.wait(lock, [this, seen]{return stop_ || generation_ != seen;});
+				if (stop_)
+					return;
+				seen = generation_;
+				lock.unlock();
+				drain();
+				lock.lock();
+				if (--running_ == 0)
+					done_.notify_one();
+			}
+		}
+
+	public:
+		/**
+		 * @brief      Starts thread_count - 1 workers.
+		 *
+		 * @param[in]  thread_count  Number of threads working on a parallel_for, counting the caller. 0 means one per hardware thread.
+		 */
+		explicit thread_pool(unsigned thread_count = 0) :
+			invoke_(nullptr),
+			job_(nullptr),
+			task_count_(0),
+			next_task_(0),
+			running_(0),
+			generation_(0),
+			stop_(false)
+		{
+			if (thread_count == 0)
+				thread_count = std::max(1u, std::thread::hardware_concurrency());
+			workers_.reserve(thread_count - 1);
+			for (unsigned i = 1; i < thread_count; ++i)
+				workers_.emplace_back(&thread_pool::work, this);
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		/**
+		 * @brief      Stops and joins the workers.
+		 */
+		~thread_pool(){
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (std::thread& worker : workers_)
+				worker.join();
+		}
+
+		/**
+		 * @brief      Number of threads working on a parallel_for, counting the caller.
+		 */
+		inline unsigned size() const {return workers_.size() + 1;}
+
+		/**
+		 * @brief      Calls fn(i) for every i in [0, task_count) spread over the pool and waits for all of them.
+		 * Calls from inside a task run inline. The first exception thrown by a task is rethrown once all tasks are done.
+		 *
+		 * @param[in]  task_count  Number of tasks
+		 * @param      fn          Callable taking the task index
+		 */
+		template <class Function>
+		void parallel_for(std::size_t task_count, Function&& fn){
+			if (workers_.empty() || task_count < 2 || inside_task()){
+				for (std::size_t task = 0; task < task_count; ++task)
+					fn(task);
+				return;
+			}
+			std::lock_guard<std::mutex> call_lock(call_mutex_);
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				invoke_ = &invoke<typename std::remove_reference<Function>::type>;
+				job_ = const_cast<void*>(static_cast<const volatile void*>(std::addressof(fn)));
+				task_count_ = task_count;
+				next_task_.store(0, std::memory_order_relaxed);
+				running_ = workers_.size();
+				error_ = nullptr;
+				++generation_;
+			}
+			wake_.notify_all();
+			drain();
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_.wait(lock, [this]{return running_ == 0;});
+			if (error_)
+				std::rethrow_exception(std::exchange(error_, nullptr));
+		}
+
+		/**
+		 * @brief      Process wide pool with one thread per hardware thread, started on first use.
+		 */
+		static thread_pool& shared(){
+			static thread_pool pool;
+			return pool;
+		}
+	};
+}
+
+#endif
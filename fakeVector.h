@@ -2,22 +2,308 @@
 #define FAKEVECTOR_H
 
 #include <initializer_list>
+#include <cassert>
 #include <algorithm>
 #include <iterator>
 #include <exception>
+#include <stdexcept>
 #include <memory>
 #include <cstddef>
+#include <cstring>
+#include <type_traits>
 #include <utility>
+#include <array>
+#include "fakeAllocator.h"
+
+/**
+ * With C++20 constexpr allocation the vector can be used in constant expressions, as long as everything it allocates
+ * there is freed before the evaluation ends. Use fake::freeze to keep the result of such a computation.
+ */
+#if defined(__cpp_lib_constexpr_dynamic_alloc) && __cpp_lib_constexpr_dynamic_alloc >= 201907L
+#define FAKE_CONSTEXPR constexpr
+#define FAKE_HAS_CONSTEXPR_VECTOR 1
+#else
+#define FAKE_CONSTEXPR
+#define FAKE_HAS_CONSTEXPR_VECTOR 0
+#endif
 
 namespace fake{
+	namespace detail{
+		/**
+		 * @brief      True while running in a constant expression, where paths such as memcpy must be avoided.
+		 * Always false before C++20.
+		 */
+		constexpr inline bool is_constant_evaluated(){
+#if FAKE_HAS_CONSTEXPR_VECTOR
+			return std::is_constant_evaluated();
+#else
+			return false;
+#endif
+		}
+
+		/**
+		 * @brief      Checks whether an iterator points into contiguous storage (raw pointers and __normal_iterator wrappers).
+		 *
+		 * @tparam     Iterator  Iterator type
+		 */
+		template <class Iterator>
+		struct is_contiguous_iterator : std::is_pointer<Iterator> {};
+
+		template <class Pointer, class Container>
+		struct is_contiguous_iterator<__gnu_cxx::__normal_iterator<Pointer, Container>> : std::is_pointer<Pointer> {};
+
+		/**
+		 * @brief      Unwraps a contiguous iterator to the raw pointer it holds.
+		 */
+		template <class T>
+		inline T* to_pointer(T* it){return it;}
+
+		template <class Pointer, class Container>
+		inline Pointer to_pointer(__gnu_cxx::__normal_iterator<Pointer, Container> it){return it.base();}
+	}
+
+	/**
+	 * @brief      Marks types whose objects can be moved to another address with memcpy, the source then being
+	 * treated as raw memory without running its destructor. True for trivially copyable types, specialize it for
+	 * types such as owning handles whose move constructor and destructor only transfer a pointer.
+	 *
+	 * @tparam     T     Element type
+	 */
+	template <class T>
+	struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+	/**
+	 * @brief      Marks types whose value-initialized object is all zero bytes, so value-initialization can be a memset.
+	 * True for arithmetic, enum and pointer types, specialize it for aggregates of them.
+	 *
+	 * @tparam     T     Element type
+	 */
+	template <class T>
+	struct is_zero_initializable : std::integral_constant<bool,
+		std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+	namespace detail{
+		template <class... Types>
+		struct make_void{typedef void type;};
+
+		template <class Alloc, class T, class = void>
+		struct has_construct : std::false_type {};
+
+		template <class Alloc, class T>
+		struct has_construct<Alloc, T, typename make_void<decltype(std::declval<Alloc&>().construct(std::declval<T*>(), std::declval<const T&>()))>::type> : std::true_type {};
+
+		template <class Alloc, class T, class = void>
+		struct has_destroy : std::false_type {};
+
+		template <class Alloc, class T>
+		struct has_destroy<Alloc, T, typename make_void<decltype(std::declval<Alloc&>().destroy(std::declval<T*>()))>::type> : std::true_type {};
+
+		/**
+		 * @brief      Allocators with allocate_zeroed(n), returning memory for n elements with all bytes zero.
+		 */
+		template <class Alloc, class = void>
+		struct has_allocate_zeroed : std::false_type {};
+
+		template <class Alloc>
+		struct has_allocate_zeroed<Alloc, typename make_void<decltype(std::declval<Alloc&>().allocate_zeroed(std::size_t()))>::type> : std::true_type {};
+
+		/**
+		 * @brief      Allocators with a static shrink_when_sparse set to true, see fake::shrinking_allocator.
+		 */
+		template <class Alloc, class = void>
+		struct shrinks_when_sparse : std::false_type {};
+
+		template <class Alloc>
+		struct shrinks_when_sparse<Alloc, typename make_void<decltype(Alloc::shrink_when_sparse)>::type> :
+			std::integral_constant<bool, Alloc::shrink_when_sparse> {};
+
+		/**
+		 * @brief      Checks whether all bytes of an object are zero.
+		 */
+		template <class T>
+		inline bool is_zero_bits(const T& value){
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(std::addressof(value));
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+				if (bytes[i])
+					return false;
+			return true;
+		}
+
+		/**
+		 * @brief      Decides which element operations of a vector can bypass the per-element loops. The bulk paths
+		 * are only taken when the allocator constructs and destroys the usual way, an allocator with its own
+		 * construct or destroy sees every element.
+		 *
+		 * @tparam     T      Element type
+		 * @tparam     Alloc  Allocator type
+		 */
+		template <class T, class Alloc>
+		struct element_traits{
+			static const bool plain_allocator = std::is_same<Alloc, std::allocator<T>>::value ||
+				(!has_construct<Alloc, T>::value && !has_destroy<Alloc, T>::value);
+			// destroying is a no-op
+			static const bool trivial_destroy = plain_allocator && std::is_trivially_destructible<T>::value;
+			// copies from contiguous storage are a memcpy
+			static const bool trivial_copy = plain_allocator && std::is_trivially_copyable<T>::value;
+			// moving to a new array or shifting inside it is a memcpy or memmove, sources are not destroyed
+			static const bool trivial_relocate = plain_allocator && is_trivially_relocatable<T>::value;
+			// value-initialization is a memset to zero
+			static const bool zero_fill = plain_allocator && is_zero_initializable<T>::value;
+			// value-initialized arrays come zeroed from the allocator
+			static const bool zero_allocate = zero_fill && has_allocate_zeroed<Alloc>::value;
+		};
+
+		/**
+		 * @brief      Holds an allocator. Empty allocators are stored as a base class so they take up no space
+		 * in the object deriving from this one (empty base optimization).
+		 *
+		 * @tparam     Alloc  Allocator type
+		 */
+		template <class Alloc, bool = std::is_empty<Alloc>::value && !std::is_final<Alloc>::value>
+		class allocator_holder{
+		private:
+			Alloc allocator_;
+		public:
+			explicit
+			FAKE_CONSTEXPR allocator_holder(const Alloc& alloc) :
+				allocator_(alloc)
+				{};
+			FAKE_CONSTEXPR inline Alloc& allocator(){return allocator_;}
+			FAKE_CONSTEXPR inline const Alloc& allocator() const {return allocator_;}
+		};
+
+		template <class Alloc>
+		class allocator_holder<Alloc, true> : private Alloc{
+		public:
+			explicit
+			FAKE_CONSTEXPR allocator_holder(const Alloc& alloc) :
+				Alloc(alloc)
+				{};
+			FAKE_CONSTEXPR inline Alloc& allocator(){return *this;}
+			FAKE_CONSTEXPR inline const Alloc& allocator() const {return *this;}
+		};
+	}
+
+	namespace detail{
+		/**
+		 * @brief      Marks lazily evaluated element-wise expressions a vector can be built from or assigned.
+		 * Specialized in fakeExpression.h, an expression has a value_type, size() and evaluate(value_type* out).
+		 */
+		template <class Expression>
+		struct is_vector_expression : std::false_type {};
+	}
+
+	/**
+	 * @brief      View of size contiguous elements starting at data. Does not own them.
+	 *
+	 * @tparam     T     Element type, const for read-only spans
+	 */
+	template <class T>
+	class span{
+	private:
+		T* data_;
+		std::size_t size_;
+	public:
+		typedef T element_type;
+		typedef typename std::remove_cv<T>::type value_type;
+		typedef T* iterator;
+		typedef std::size_t size_type;
+
+		span() :
+			data_(nullptr),
+			size_(0)
+			{};
+
+		span(T* data, size_type size) :
+			data_(data),
+			size_(size)
+			{};
+
+		inline iterator begin() const {return data_;}
+		inline iterator end() const {return data_ + size_;}
+		inline T* data() const {return data_;}
+		inline size_type size() const {return size_;}
+		inline bool empty() const {return size_ == 0;}
+		inline T& operator[](size_type i) const {return data_[i];}
+		inline T& front() const {return data_[0];}
+		inline T& back() const {return data_[size_ - 1];}
+	};
+
+	/**
+	 * @brief      Splits size contiguous elements into spans of chunk_size elements, the last one can be shorter.
+	 *
+	 * @tparam     T     Element type, const for read-only spans
+	 */
+	template <class T>
+	class span_chunks{
+	private:
+		T* data_;
+		std::size_t size_;
+		std::size_t chunk_size_;
+	public:
+		typedef span<T> value_type;
+		typedef std::size_t size_type;
+
+		class iterator{
+		private:
+			T* it_;
+			T* end_;
+			std::size_t chunk_size_;
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef span<T> value_type;
+			typedef value_type reference;
+			typedef std::ptrdiff_t difference_type;
+			typedef void pointer;
+
+			iterator() : it_(nullptr), end_(nullptr), chunk_size_(1) {};
+			iterator(T* it, T* end, std::size_t chunk_size) : it_(it), end_(end), chunk_size_(chunk_size) {};
+
+			inline reference operator*() const {
+				const std::size_t left = end_ - it_;
+				return value_type(it_, left < chunk_size_ ? left : chunk_size_);
+			}
+			inline iterator& operator++(){
+				const std::size_t left = end_ - it_;
+				it_ += left < chunk_size_ ? left : chunk_size_;
+				return *this;
+			}
+			inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+			inline bool operator==(const iterator& other) const {return it_ == other.it_;}
+			inline bool operator!=(const iterator& other) const {return it_ != other.it_;}
+		};
+
+		span_chunks(T* data, size_type size, size_type chunk_size) :
+			data_(data),
+			size_(size),
+			chunk_size_(chunk_size)
+			{
+				assert(chunk_size > 0 && "chunk size must be positive");
+			};
+
+		inline iterator begin() const {return iterator(data_, data_ + size_, chunk_size_);}
+		inline iterator end() const {return iterator(data_ + size_, data_ + size_, chunk_size_);}
+		inline size_type size() const {return (size_ + chunk_size_ - 1) / chunk_size_;}
+		inline bool empty() const {return size_ == 0;}
+
+		/**
+		 * @brief      The i-th chunk, for handing chunks out by index.
+		 */
+		inline span<T> operator[](size_type i) const {
+			const size_type first = i * chunk_size_, left = size_ - first;
+			return span<T>(data_ + first, left < chunk_size_ ? left : chunk_size_);
+		}
+	};
+
 	/**
 	 * @brief      Vector class. A copy of std::vector.
+	 * The vector is three pointers wide, an empty allocator adds nothing to its size.
 	 *
 	 * @tparam     T      Type of elements to hold
 	 * @tparam     Alloc  Allocator for the vector
 	 */
 	template <class T, class Alloc = std::allocator<T>>
-	class vector{
+	class vector : private detail::allocator_holder<Alloc>{
 	public:
 		typedef T 																value_type;
 		typedef Alloc 															allocator_type;
@@ -32,66 +318,326 @@ namespace fake{
 		typedef std::ptrdiff_t 													difference_type;
 		typedef size_t 															size_type;
 	private:
+		typedef detail::allocator_holder<Alloc> allocator_base;
+		typedef detail::element_traits<value_type, allocator_type> element_traits;
+
+		/**
+		 * Range pointer to the start of the array.
+		 */
+		pointer array_start_;
 		/**
-		 * Allocator associated to the vector.
+		 * Range pointer to the end of size of the array.
+		 */
+		pointer array_end_;
+		/**
+		 * Range pointer to the end of capacity of the array.
 		 */
-		allocator_type allocator_;
+		pointer array_range_end_;
 
 		/**
-		 * Capacity of the vector.
+		 * @brief      Allocator associated to the vector.
+		 *
+		 * @return     Reference to the allocator.
 		 */
-		size_type capacity_;
+		FAKE_CONSTEXPR inline allocator_type& allocator(){return allocator_base::allocator();}
+		FAKE_CONSTEXPR inline const allocator_type& allocator() const {return allocator_base::allocator();}
+
 		/**
-		 * Size of the vector.
+		 * @brief      Allocates memory for n elements. Allocating zero elements gives a null pointer.
+		 *
+		 * @param[in]  n     Element count
+		 *
+		 * @return     Pointer to the allocated memory.
 		 */
-		size_type size_;
+		FAKE_CONSTEXPR pointer allocate(size_type n){
+			return n ? std::allocator_traits<allocator_type>::allocate(allocator(), n) : pointer();
+		}
+
 		/**
-		 * Pointer to the array.
+		 * @brief      Allocates memory for n elements and value-initializes them. Zero-initializable elements are
+		 * taken zeroed from an allocator with allocate_zeroed (see fakeAllocator.h) and not written at all.
+		 *
+		 * @param[in]  n     Element count
+		 *
+		 * @return     Pointer to the allocated memory.
 		 */
-		pointer array_;
+		FAKE_CONSTEXPR pointer allocate_value_initialized(size_type n){
+			return allocate_value_initialized(n, std::integral_constant<bool, element_traits::zero_allocate>());
+		}
+
+		FAKE_CONSTEXPR pointer allocate_value_initialized(size_type n, std::false_type){
+			pointer array = allocate(n);
+			construct_elements(array, n);
+			return array;
+		}
+
+		pointer allocate_value_initialized(size_type n, std::true_type){
+			return n ? allocator().allocate_zeroed(n) : pointer();
+		}
 
 		/**
-		 * Range pointer to the start of the array.
+		 * @brief      Allocates memory for n elements and constructs them with value. A value whose bytes are all
+		 * zero is treated as value-initialization.
+		 *
+		 * @param[in]  n      Element count
+		 * @param[in]  value  The value
+		 *
+		 * @return     Pointer to the allocated memory.
 		 */
-		pointer array_start_;
+		FAKE_CONSTEXPR pointer allocate_filled(size_type n, const value_type& value){
+			return allocate_filled(n, value, std::integral_constant<bool, element_traits::zero_allocate>());
+		}
+
+		FAKE_CONSTEXPR pointer allocate_filled(size_type n, const value_type& value, std::false_type){
+			pointer array = allocate(n);
+			construct_elements(array, n, value);
+			return array;
+		}
+
+		pointer allocate_filled(size_type n, const value_type& value, std::true_type){
+			if (detail::is_zero_bits(value))
+				return allocate_value_initialized(n, std::true_type());
+			return allocate_filled(n, value, std::false_type());
+		}
+
 		/**
-		 * Range pointer to the end of size of the array.
+		 * @brief      Deallocates the array of the vector.
 		 */
-		pointer array_end_;
+		FAKE_CONSTEXPR void deallocate(){
+			if (array_start_)
+				std::allocator_traits<allocator_type>::deallocate(allocator(), array_start_, capacity());
+		}
+
 		/**
-		 * Range pointer to the end of capacity of the array.
+		 * @brief      Constructs one element at p through the allocator.
+		 *
+		 * @param[in]  p     Pointer to raw memory for the element
+		 * @param[in]  args  Arguments to forward to the constructor of the element
+		 *
+		 * @tparam     Args  Arguments template
 		 */
-		pointer array_range_end_;
+		template <class... Args>
+		FAKE_CONSTEXPR inline void construct_element(pointer p, Args&&... args){
+			std::allocator_traits<allocator_type>::construct(allocator(), p, std::forward<Args>(args)...);
+		}
+
+		/**
+		 * @brief      Destroys the element at p through the allocator.
+		 */
+		FAKE_CONSTEXPR inline void destroy_element(pointer p){
+			std::allocator_traits<allocator_type>::destroy(allocator(), p);
+		}
 
 		/**
-		 * @brief      Reassigns range pointers to their correct values.
+		 * @brief      Takes the allocator of x on copy assignment when the allocator asks for it. The array allocated
+		 * with the old allocator is released first if the two allocators differ.
+		 *
+		 * @param[in]  x     Vector being copied
 		 */
+		FAKE_CONSTEXPR void copy_allocator(const vector& x, std::true_type){
+			if (allocator() != x.allocator()){
+				destroy_elements(array_start_, size());
+				deallocate();
+				set_pointers(nullptr, 0, 0);
+			}
+			allocator() = x.allocator();
+		}
 
-		void set_pointers(){
-			array_start_ = array_;
-			array_end_ = array_ + size_;  
-			array_range_end_ = array_ + capacity_;
+		FAKE_CONSTEXPR void copy_allocator(const vector&, std::false_type){}
+
+		/**
+		 * @brief      Points the vector at a new array.
+		 *
+		 * @param[in]  array     Pointer to the array
+		 * @param[in]  size      Number of constructed elements in the array
+		 * @param[in]  capacity  Number of elements the array has room for
+		 */
+		FAKE_CONSTEXPR void set_pointers(pointer array, size_type size, size_type capacity){
+			array_start_ = array;
+			array_end_ = array + size;
+			array_range_end_ = array + capacity;
 		}
 
 		/**
-		 * @brief      Creates a pointer to a new array. Allocates new_size worth of memory and constructs the elements from the old array.
-		 * The old array elements are destroyed and deallocated.
+		 * @brief      Creates a pointer to a new array. Allocates new_size worth of memory and moves the elements from the old array
+		 * (copies them if their move constructor may throw). The old array elements are destroyed and deallocated.
 		 *
 		 * @param[in]  new_size  new array size
 		 */
-		void increase_array(size_type new_size){
-			pointer new_array = allocator_.allocate(new_size);
-			construct_elements(begin(), std::min(end(), begin() + new_size), new_array);
-			
-			destroy_elements(array_, size_);
-			allocator_.deallocate(array_, capacity_);
-			array_ = new_array;
-			capacity_ = new_size;
-			set_pointers();
+		FAKE_CONSTEXPR void increase_array(size_type new_size){
+			const size_type old_size = std::min(size(), new_size);
+			pointer new_array = allocate(new_size);
+			relocate_elements(array_start_, array_start_ + old_size, new_array);
+
+			destroy_relocated(array_start_, old_size);
+			destroy_elements(array_start_ + old_size, size() - old_size);
+			deallocate();
+			set_pointers(new_array, old_size, new_size);
+		}
+
+		/**
+		 * @brief      Grows the array to new_size elements taken zeroed from the allocator, so the elements past
+		 * the relocated ones are already value-initialized.
+		 *
+		 * @param[in]  new_size  New array size, greater than the size
+		 *
+		 * @return     False if the elements cannot be zero-allocated, the vector is left untouched then.
+		 */
+		FAKE_CONSTEXPR bool increase_array_zeroed(size_type, std::false_type){return false;}
+
+		bool increase_array_zeroed(size_type new_size, std::true_type){
+			const size_type old_size = size();
+			pointer new_array = allocate_value_initialized(new_size, std::true_type());
+			relocate_elements(array_start_, array_end_, new_array);
+			destroy_relocated(array_start_, old_size);
+			deallocate();
+			set_pointers(new_array, old_size, new_size);
+			return true;
+		}
+
+		/**
+		 * @brief      Destroys the last element, without shrinking.
+		 */
+		FAKE_CONSTEXPR void remove_last(){
+			--array_end_;
+			destroy_element(array_end_);
+		}
+
+		/**
+		 * @brief      Called after elements are removed. With an allocator that asks for it (see fake::shrinking_allocator),
+		 * reallocates to twice the size once the size falls under a quarter of the capacity.
+		 */
+		FAKE_CONSTEXPR void shrink_if_sparse(){
+			shrink_if_sparse(detail::shrinks_when_sparse<allocator_type>());
+		}
+
+		FAKE_CONSTEXPR void shrink_if_sparse(std::false_type){}
+
+		FAKE_CONSTEXPR void shrink_if_sparse(std::true_type){
+			if (size() < capacity() / 4)
+				increase_array(2 * size());
+		}
+
+		/**
+		 * @brief      Slow path of emplace_back, taken when the array is full. Kept out of line and marked cold so the
+		 * fast path inlined at every call site stays a compare, a construct and a pointer bump.
+		 * The new element is constructed before the old ones are relocated, so args may refer to an element of the vector.
+		 *
+		 * @param[in]  args       Arguments to forward to the constructor of the element
+		 *
+		 * @tparam     Args       Arguments template
+		 */
+		template <class... Args>
+		[[gnu::noinline, gnu::cold]]
+		FAKE_CONSTEXPR void realloc_emplace_back(Args&&... args){
+			const size_type old_size = size();
+			const size_type new_capacity = std::max<size_type>(1, 2*capacity());
+			pointer new_array = allocate(new_capacity);
+			construct_element(new_array + old_size, std::forward<Args>(args)...);
+			relocate_elements(array_start_, array_end_, new_array);
+
+			destroy_relocated(array_start_, old_size);
+			deallocate();
+			set_pointers(new_array, old_size + 1, new_capacity);
+		}
+
+		/**
+		 * @brief      Opens a gap of count uninitialized elements at index, growing the array if needed.
+		 * When growing, the elements are relocated straight into their final places in the new array,
+		 * otherwise the tail is shifted right by moving it from the back.
+		 *
+		 * @param[in]  index  Index of the first element of the gap
+		 * @param[in]  count  Number of elements in the gap
+		 *
+		 * @return     Pointer to the start of the gap.
+		 */
+		FAKE_CONSTEXPR pointer make_gap(size_type index, size_type count){
+			if (count == 0)
+				return array_start_ + index;
+			const size_type old_size = size();
+			if (old_size + count > capacity()){
+				const size_type new_capacity = std::max(2*capacity(), old_size + count);
+				pointer new_array = allocate(new_capacity);
+				relocate_elements(array_start_, array_start_ + index, new_array);
+				relocate_elements(array_start_ + index, array_end_, new_array + index + count);
+				destroy_relocated(array_start_, old_size);
+				deallocate();
+				set_pointers(new_array, old_size + count, new_capacity);
+			} else {
+				shift_elements(array_start_ + index, count, std::integral_constant<bool, element_traits::trivial_relocate>());
+				array_end_ += count;
+			}
+			return array_start_ + index;
+		}
+
+		/**
+		 * @brief      Shifts the elements from position to the end right by count places, within the capacity.
+		 * The vacated places are left uninitialized. Trivially relocatable elements are moved with one memmove.
+		 *
+		 * @param[in]  position  Pointer to the first element to shift
+		 * @param[in]  count     Number of places
+		 */
+		FAKE_CONSTEXPR void shift_elements(pointer position, size_type count, std::false_type){
+			const size_type shifted = array_end_ - position;
+			for (pointer source = array_end_; source != position; ){
+				--source;
+				if (source + count >= array_end_)
+					construct_element(source + count, std::move(*source));
+				else
+					*(source + count) = std::move(*source);
+			}
+			destroy_elements(position, std::min(count, shifted));
+		}
+
+		FAKE_CONSTEXPR void shift_elements(pointer position, size_type count, std::true_type){
+			if (detail::is_constant_evaluated())
+				shift_elements(position, count, std::false_type());
+			else if (position != array_end_)
+				std::memmove(static_cast<void*>(position + count), static_cast<const void*>(position), (array_end_ - position) * sizeof(value_type));
+		}
+
+		/**
+		 * @brief      Constructs elements from range [first, last) to a pointer by moving them.
+		 * Falls back to copying if the move constructor of value_type may throw.
+		 * Trivially relocatable elements are copied with a single memcpy, the sources must then be released with
+		 * destroy_relocated.
+		 *
+		 * @param[in]  first        Pointer to begin of range
+		 * @param[in]  last         Pointer to end of range
+		 * @param[in]  destination  Pointer to destination
+		 */
+		FAKE_CONSTEXPR void relocate_elements(pointer first, pointer last, pointer destination){
+			relocate_elements(first, last, destination, std::integral_constant<bool, element_traits::trivial_relocate>());
+		}
+
+		FAKE_CONSTEXPR void relocate_elements(pointer first, pointer last, pointer destination, std::false_type){
+			for (; first != last; ++first, ++destination)
+				construct_element(destination, std::move_if_noexcept(*first));
+		}
+
+		FAKE_CONSTEXPR void relocate_elements(pointer first, pointer last, pointer destination, std::true_type){
+			if (detail::is_constant_evaluated())
+				relocate_elements(first, last, destination, std::false_type());
+			else if (first != last)
+				std::memcpy(static_cast<void*>(destination), static_cast<const void*>(first), (last - first) * sizeof(value_type));
+		}
+
+		/**
+		 * @brief      Ends the lifetime of n elements that relocate_elements moved away. Bitwise relocated elements
+		 * now live at their destination and are not destroyed.
+		 *
+		 * @param[in]  start  Pointer to the start of range
+		 * @param[in]  n      Number of elements
+		 */
+		FAKE_CONSTEXPR void destroy_relocated(pointer start, size_type n){
+			if (!element_traits::trivial_relocate || detail::is_constant_evaluated())
+				destroy_elements(start, n);
 		}
 
 		/**
 		 * @brief      Constructs elements from range [begin, end) to a pointer.
+		 * Trivially copyable elements held in contiguous storage are copied with a single memcpy,
+		 * except in constant expressions where memcpy is not allowed.
 		 *
 		 * @param[in]  begin          Iterator to begin of range
 		 * @param[in]  end            Iterator to end of range
@@ -101,13 +647,26 @@ namespace fake{
 		 * @tparam     <unnamed>      { description }
 		 */
 		template <class InputIterator, typename = std::_RequireInputIter<InputIterator>>
-		void construct_elements(InputIterator begin, InputIterator end, pointer destination){
-			// std::cout << "cons 1" << std::endl;
-			const difference_type distance = end - begin;
-			for (unsigned int i = 0; i < distance; ++i){
-				allocator_.construct(destination + i, *(begin));
-				begin++;
-			}
+		FAKE_CONSTEXPR void construct_elements(InputIterator begin, InputIterator end, pointer destination){
+			typedef typename std::iterator_traits<InputIterator>::value_type source_type;
+			construct_elements(begin, end, destination, std::integral_constant<bool,
+				detail::is_contiguous_iterator<InputIterator>::value &&
+				std::is_same<typename std::remove_cv<source_type>::type, value_type>::value &&
+				element_traits::trivial_copy>());
+		}
+
+		template <class InputIterator>
+		FAKE_CONSTEXPR void construct_elements(InputIterator begin, InputIterator end, pointer destination, std::false_type){
+			for (; begin != end; ++begin, ++destination)
+				construct_element(destination, *begin);
+		}
+
+		template <class InputIterator>
+		FAKE_CONSTEXPR void construct_elements(InputIterator begin, InputIterator end, pointer destination, std::true_type){
+			if (detail::is_constant_evaluated())
+				construct_elements(begin, end, destination, std::false_type());
+			else if (begin != end)
+				std::memcpy(static_cast<void*>(destination), detail::to_pointer(begin), (end - begin) * sizeof(value_type));
 		}
 
 		/**
@@ -117,24 +676,92 @@ namespace fake{
 		 * @param[in]  count        Number of elements
 		 * @param[in]  value        Value
 		 */
-		void construct_elements(pointer destination, size_type count, value_type value){
-			// std::cout << "cons 2" << std::endl;
+		FAKE_CONSTEXPR void construct_elements(pointer destination, size_type count, const value_type& value){
+			for (size_type i = 0; i < count; ++i)
+				construct_element(destination + i, value);
+		}
+
+		/**
+		 * @brief      Value-initializes count number of elements at a pointer.
+		 * Elements whose value-initialized state is all zero bytes are set with a single memset.
+		 *
+		 * @param[in]  destination  Pointer to destination
+		 * @param[in]  count        Number of elements
+		 */
+		FAKE_CONSTEXPR void construct_elements(pointer destination, size_type count){
+			construct_elements(destination, count, std::integral_constant<bool, element_traits::zero_fill>());
+		}
+
+		FAKE_CONSTEXPR void construct_elements(pointer destination, size_type count, std::false_type){
 			for (size_type i = 0; i < count; ++i)
-				allocator_.construct(destination + i, value);
+				construct_element(destination + i);
+		}
+
+		FAKE_CONSTEXPR void construct_elements(pointer destination, size_type count, std::true_type){
+			if (detail::is_constant_evaluated())
+				construct_elements(destination, count, std::false_type());
+			else if (count)
+				std::memset(static_cast<void*>(destination), 0, count * sizeof(value_type));
 		}
 
 		/**
-		 * @brief      Destroys the first n elements of array start.
+		 * @brief      Appends the elements from range [first, last) of unknown length, growing as push_back would.
+		 */
+		template <class InputIterator>
+		FAKE_CONSTEXPR void append_elements(InputIterator first, InputIterator last, std::input_iterator_tag){
+			for (; first != last; ++first)
+				emplace_back(*first);
+		}
+
+		/**
+		 * @brief      Appends the elements from range [first, last) whose length is known up front, reallocating at most once.
+		 */
+		template <class ForwardIterator>
+		FAKE_CONSTEXPR void append_elements(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag){
+			const size_type count = std::distance(first, last);
+			if (size() + count > capacity())
+				increase_array(std::max(2*capacity(), size() + count));
+			construct_elements(first, last, array_end_);
+			array_end_ += count;
+		}
+
+		/**
+		 * @brief      Inserts the elements from range [first, last) of unknown length by appending them and rotating them into place.
+		 */
+		template <class InputIterator>
+		FAKE_CONSTEXPR void insert_elements(size_type index, InputIterator first, InputIterator last, std::input_iterator_tag){
+			const size_type old_size = size();
+			append_elements(first, last, std::input_iterator_tag());
+			std::rotate(begin() + index, begin() + old_size, end());
+		}
+
+		/**
+		 * @brief      Inserts the elements from range [first, last) whose length is known up front, reallocating at most once.
+		 */
+		template <class ForwardIterator>
+		FAKE_CONSTEXPR void insert_elements(size_type index, ForwardIterator first, ForwardIterator last, std::forward_iterator_tag){
+			const size_type count = std::distance(first, last);
+			construct_elements(first, last, make_gap(index, count));
+		}
+
+		/**
+		 * @brief      Destroys the first n elements of array start. Nothing to do for trivially destructible elements.
 		 *
 		 * @param[in]  start  Pointer to the start of range
 		 * @param[in]  n      Number of elements
 		 */
-		void destroy_elements(pointer start, size_type n){
-			for (int i = 0; i < n; ++i){
-				allocator_.destroy(start + i);
+		FAKE_CONSTEXPR void destroy_elements(pointer start, size_type n){
+			destroy_elements(start, n, std::integral_constant<bool, element_traits::trivial_destroy>());
+		}
+
+		FAKE_CONSTEXPR void destroy_elements(pointer start, size_type n, std::false_type){
+			for (size_type i = 0; i < n; ++i){
+				destroy_element(start + i);
 			}
 		}
 
+		FAKE_CONSTEXPR void destroy_elements(pointer, size_type, std::true_type){}
+
 	public:
 		// Constructors
 
@@ -144,55 +771,44 @@ namespace fake{
 		 * @param[in]  alloc  Custom allocator
 		 */
 		explicit
-		vector(const allocator_type& alloc = allocator_type()) : 
-			allocator_(alloc),
-			capacity_(0), 
-			size_(0), 
-			array_(nullptr),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
-			{}; 
+		FAKE_CONSTEXPR vector(const allocator_type& alloc = allocator_type()) :
+			allocator_base(alloc),
+			array_start_(nullptr),
+			array_end_(nullptr),
+			array_range_end_(nullptr)
+			{};
 
 		/**
-		 * @brief      Constructor with defined size. Allocates memory for n elements.
+		 * @brief      Constructor with defined size. Allocates memory for n elements and value-initializes them.
 		 *
 		 * @param[in]  n     Element count
 		 */
-		explicit 
-		vector(size_type n) : 
-			allocator_(),
-			capacity_(n), 
-			size_(n), 
-			array_(allocator_.allocate(n)),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_) 
+		explicit
+		FAKE_CONSTEXPR vector(size_type n) :
+			allocator_base(allocator_type()),
+			array_start_(allocate_value_initialized(n)),
+			array_end_(array_start_ + n),
+			array_range_end_(array_start_ + n)
 			{};
 
 		/**
 		 * @brief      Constructor with defined size, value and a possible custom allocator.
 		 * Allocates memory for n elements and constructs n values val.
-		 * 
+		 *
 		 *
 		 * @param[in]  n      { parameter_description }
 		 * @param[in]  val    The value
 		 * @param[in]  alloc  The allocate
 		 */
-		vector(size_type n, value_type val, const allocator_type& alloc = allocator_type()) : 
-			allocator_(alloc),
-			capacity_(n), 
-			size_(n), 
-			array_(allocator_.allocate(n)),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_) 
-			{
-				construct_elements(array_, n, val);
-			};
+		FAKE_CONSTEXPR vector(size_type n, const value_type& val, const allocator_type& alloc = allocator_type()) :
+			allocator_base(alloc),
+			array_start_(allocate_filled(n, val)),
+			array_end_(array_start_ + n),
+			array_range_end_(array_start_ + n)
+			{};
 
 		/**
-		 * @brief      Constructor with defined iterator range [first, last). Allocates memory for enough elements in this range and constructs them. 
+		 * @brief      Constructor with defined iterator range [first, last). Allocates memory for enough elements in this range and constructs them.
 		 *
 		 * @param[in]  first          Iterator to begin of range
 		 * @param[in]  last           Iterator to end of range
@@ -202,108 +818,111 @@ namespace fake{
 		 * @tparam     <unnamed>      { description }
 		 */
 		template <class InputIterator, typename = std::_RequireInputIter<InputIterator>>
-		vector(InputIterator first, InputIterator last, const allocator_type& alloc = allocator_type()) : 
-			allocator_(alloc),
-			capacity_(static_cast<size_type>(last-first)), 
-			size_(static_cast<size_type>(last-first)), 
-			array_(allocator_.allocate(static_cast<size_type>(last-first))),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
+		FAKE_CONSTEXPR vector(InputIterator first, InputIterator last, const allocator_type& alloc = allocator_type()) :
+			allocator_base(alloc),
+			array_start_(nullptr),
+			array_end_(nullptr),
+			array_range_end_(nullptr)
+			{
+				append_range(first, last);
+			};
+
+		/**
+		 * @brief      Constructor from an element-wise expression (see fakeExpression.h), evaluated in a single pass.
+		 *
+		 * @param[in]  expression  The expression
+		 * @param[in]  alloc       The allocator
+		 *
+		 * @tparam     Expression  Expression type
+		 */
+		template <class Expression, typename = typename std::enable_if<detail::is_vector_expression<Expression>::value>::type>
+		vector(const Expression& expression, const allocator_type& alloc = allocator_type()) :
+			allocator_base(alloc),
+			array_start_(allocate(expression.size())),
+			array_end_(array_start_ + expression.size()),
+			array_range_end_(array_start_ + expression.size())
 			{
-				construct_elements(first, last, array_start_);
+				static_assert(std::is_same<typename Expression::value_type, value_type>::value, "expression and vector element types differ");
+				expression.evaluate(array_start_);
 			};
 
 		/**
-		 * @brief      Copy constructor for fake::vector type. 
+		 * @brief      Copy constructor for fake::vector type.
 		 *
 		 * @param[in]  x     Vector to be copied
 		 */
-		vector(const vector& x) : 
-			allocator_(),
-			capacity_(x.capacity()),
-			size_(x.size()),
-			array_(allocator_.allocate(x.capacity())),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
+		FAKE_CONSTEXPR vector(const vector& x) :
+			allocator_base(std::allocator_traits<allocator_type>::select_on_container_copy_construction(x.allocator())),
+			array_start_(allocate(x.size())),
+			array_end_(array_start_ + x.size()),
+			array_range_end_(array_start_ + x.size())
 			{
 				construct_elements(x.begin(), x.end(), array_start_);
 			};
 
 		/**
-		 * @brief      Copy constructor for fake::vector type with custom allocator. 
+		 * @brief      Copy constructor for fake::vector type with custom allocator.
 		 *
 		 * @param[in]  x     Vector to be copied
 		 * @param[in]  alloc  The allocator
 		 */
-		vector(const vector& x, const allocator_type& alloc) : 
-			allocator_(alloc),
-			capacity_(x.capacity()),
-			size_(x.size()),
-			array_(allocator_.allocate(x.capacity())),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
+		FAKE_CONSTEXPR vector(const vector& x, const allocator_type& alloc) :
+			allocator_base(alloc),
+			array_start_(allocate(x.size())),
+			array_end_(array_start_ + x.size()),
+			array_range_end_(array_start_ + x.size())
 			{
 				construct_elements(x.begin(), x.end(), array_start_);
 			};
-		
+
 		/**
 		 * @brief      Move constructor for fake::vector.
 		 *
 		 * @param[in]  x 	Vector to be moved
 		 */
-		vector(vector&& x) : 
-			allocator_(),
-			capacity_(x.capacity_),
-			size_(x.size_),
-			array_(x.array_),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
+		FAKE_CONSTEXPR vector(vector&& x) noexcept :
+			allocator_base(std::move(x.allocator())),
+			array_start_(x.array_start_),
+			array_end_(x.array_end_),
+			array_range_end_(x.array_range_end_)
 			{
-				x.array_ = nullptr;
-				x.size_ = 0;
-				x.capacity_ = 0;
-				x.set_pointers();
+				x.set_pointers(nullptr, 0, 0);
 			};
 
 		/**
-		 * @brief      Move constructor for fake::vector with custom allocator.
+		 * @brief      Move constructor for fake::vector with custom allocator. Takes over the array of x if alloc compares
+		 * equal to its allocator, otherwise allocates with alloc and moves the elements one by one.
 		 *
 		 * @param[in]  x 	Vector to be moved
 		 * @param[in]  alloc      The allocator
 		 */
-		vector(vector&& x, const allocator_type& alloc) : 
-			allocator_(alloc),
-			capacity_(x.capacity_),
-			size_(x.size_),
-			array_(x.array_),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
+		FAKE_CONSTEXPR vector(vector&& x, const allocator_type& alloc) :
+			allocator_base(alloc),
+			array_start_(nullptr),
+			array_end_(nullptr),
+			array_range_end_(nullptr)
 			{
-				x.array_ = nullptr;
-				x.size_ = 0;
-				x.capacity_ = 0;
-				x.set_pointers();
+				if (allocator() == x.allocator()){
+					set_pointers(x.array_start_, x.size(), x.capacity());
+					x.set_pointers(nullptr, 0, 0);
+				} else {
+					array_start_ = allocate(x.size());
+					array_end_ = array_range_end_ = array_start_ + x.size();
+					construct_elements(std::make_move_iterator(x.begin()), std::make_move_iterator(x.end()), array_start_);
+				}
 			};
 
 		/**
-		 * @brief      Constructor for an initializer list with possible custom allocator. Allocates enough memory for elements in the list and constructs them. 
+		 * @brief      Constructor for an initializer list with possible custom allocator. Allocates enough memory for elements in the list and constructs them.
 		 *
 		 * @param[in]  il    The initializer list
 		 * @param[in]  alloc  The allocator
 		 */
-		vector(std::initializer_list<value_type> il, const allocator_type& alloc = allocator_type()) : 
-			allocator_(alloc),
-			capacity_(il.size()),
-			size_(il.size()),
-			array_(allocator_.allocate(il.size())),
-			array_start_(array_),
-			array_end_(array_ + size_),
-			array_range_end_(array_ + capacity_)
+		FAKE_CONSTEXPR vector(std::initializer_list<value_type> il, const allocator_type& alloc = allocator_type()) :
+			allocator_base(alloc),
+			array_start_(allocate(il.size())),
+			array_end_(array_start_ + il.size()),
+			array_range_end_(array_start_ + il.size())
 			{
 				construct_elements(il.begin(), il.end(), array_start_);
 			};
@@ -311,12 +930,9 @@ namespace fake{
 		/**
 		 * @brief      Destructor for fake::vector.
 		 */
-		~vector() {
-			destroy_elements(array_, size_);
-			allocator_.deallocate(array_, capacity_);
-			array_start_ = nullptr;
-			array_end_ = nullptr;
-			array_range_end_ = nullptr;
+		FAKE_CONSTEXPR ~vector() {
+			destroy_elements(array_start_, size());
+			deallocate();
 		}
 
 		/**
@@ -326,19 +942,10 @@ namespace fake{
 		 *
 		 * @return     Returns reference to the copied vector.
 		 */
-		vector& operator=(const vector& x){
-			if (capacity_ >= x.size_){
-				size_ = x.size();
-				set_pointers();
-				construct_elements(x.begin(), x.end(), array_start_);
-			} else {
-				destroy_elements(array_, size_);
-				allocator_.deallocate(array_, capacity_);
-				capacity_ = x.size();
-				size_ = x.size();
-				array_ = allocator_.allocate(x.size());
-				set_pointers();
-				construct_elements(x.begin(), x.end(), array_start_);
+		FAKE_CONSTEXPR vector& operator=(const vector& x){
+			if (this != &x){
+				copy_allocator(x, typename std::allocator_traits<allocator_type>::propagate_on_container_copy_assignment());
+				assign(x.begin(), x.end());
 			}
 			return *this;
 		}
@@ -350,17 +957,14 @@ namespace fake{
 		 *
 		 * @return     Returns reference to the copied vector.
 		 */
-		vector& operator=(vector&& x){
-			destroy_elements(array_, capacity_);
-			allocator_.deallocate(array_, capacity_);
-			size_ = x.size_;
-			capacity_ = x.capacity_;
-			array_ = x.array_;
-			set_pointers();
-			x.size_ = 0;
-			x.capacity_ = 0;
-			x.array_ = nullptr;
-			x.set_pointers();
+		FAKE_CONSTEXPR vector& operator=(vector&& x) noexcept {
+			if (this == &x)
+				return *this;
+			destroy_elements(array_start_, size());
+			deallocate();
+			allocator() = std::move(x.allocator());
+			set_pointers(x.array_start_, x.size(), x.capacity());
+			x.set_pointers(nullptr, 0, 0);
 			return *this;
 		}
 
@@ -371,19 +975,34 @@ namespace fake{
 		 *
 		 * @return     Reference to the new vector.
 		 */
-		vector& operator=(std::initializer_list<value_type> il){
-			if (capacity_ >= il.size()){
-				size_ = il.size();
-				set_pointers();
-				construct_elements(il.begin(), il.end(), array_start_);
+		FAKE_CONSTEXPR vector& operator=(std::initializer_list<value_type> il){
+			assign(il.begin(), il.end());
+			return *this;
+		}
+
+		/**
+		 * @brief      Assigns an element-wise expression (see fakeExpression.h), evaluated in a single pass.
+		 * The vector may appear in the expression, every element only depends on the operands at the same index.
+		 *
+		 * @param[in]  expression  The expression
+		 *
+		 * @tparam     Expression  Expression type
+		 *
+		 * @return     Reference to this vector.
+		 */
+		template <class Expression, typename = typename std::enable_if<detail::is_vector_expression<Expression>::value>::type>
+		vector& operator=(const Expression& expression){
+			static_assert(std::is_same<typename Expression::value_type, value_type>::value, "expression and vector element types differ");
+			static_assert(std::is_trivially_destructible<value_type>::value, "expressions hold arithmetic elements");
+			const size_type n = expression.size();
+			if (n > capacity()){
+				pointer array = allocate(n);
+				expression.evaluate(array);
+				deallocate();
+				set_pointers(array, n, n);
 			} else {
-				destroy_elements(array_, size_);
-				allocator_.deallocate(array_, capacity_);
-				capacity_ = il.size();
-				size_ = il.size();
-				array_ = allocator_.allocate(il.size());
-				set_pointers();
-				construct_elements(il.begin(), il.end(), array_start_);
+				expression.evaluate(array_start_);
+				array_end_ = array_start_ + n;
 			}
 			return *this;
 		}
@@ -395,78 +1014,78 @@ namespace fake{
 		 *
 		 * @return     Iterator to the start of the array.
 		 */
-		inline iterator begin(){return iterator(array_start_);}
+		FAKE_CONSTEXPR inline iterator begin(){return iterator(array_start_);}
 		/**
 		 * @brief      Iterator to the end of the array.
 		 *
 		 * @return     Iterator to the end of the array.
 		 */
-		inline iterator end(){return iterator(array_end_);}
-		
+		FAKE_CONSTEXPR inline iterator end(){return iterator(array_end_);}
+
 		/**
 		 * @brief      Const_iterator to the start of the array.
 		 *
 		 * @return     Const_iterator to the start of the array.
 		 */
-		inline const_iterator begin() const {return const_iterator(array_start_);}
+		FAKE_CONSTEXPR inline const_iterator begin() const {return const_iterator(array_start_);}
 		/**
 		 * @brief      Const_iterator to the end of the array.
 		 *
 		 * @return     Const_iterator to the end of the array.
 		 */
-		inline const_iterator end() const {return const_iterator(array_end_);}
+		FAKE_CONSTEXPR inline const_iterator end() const {return const_iterator(array_end_);}
 
 		/**
 		 * @brief      Const_iterator to the start of the array.
 		 *
 		 * @return     Const_iterator to the start of the array.
 		 */
-		inline const_iterator cbegin() const {return const_iterator(array_start_);}
+		FAKE_CONSTEXPR inline const_iterator cbegin() const {return const_iterator(array_start_);}
 		/**
 		 * @brief      Const_iterator to the end of the array.
 		 *
 		 * @return     Const_iterator to the end of the array.
 		 */
-		inline const_iterator cend() const {return const_iterator(array_end_);}
+		FAKE_CONSTEXPR inline const_iterator cend() const {return const_iterator(array_end_);}
 
 		/**
 		 * @brief      Reverse iterator the end of the array.
 		 *
 		 * @return     Reverse iterator the end of the array.
 		 */
-		inline reverse_iterator rbegin(){return reverse_iterator(end());}
+		FAKE_CONSTEXPR inline reverse_iterator rbegin(){return reverse_iterator(end());}
 		/**
 		 * @brief      Reverse iterator the start of the array.
 		 *
 		 * @return     Reverse iterator the start of the array.
 		 */
-		inline reverse_iterator rend(){return reverse_iterator(begin());}
-		
+		FAKE_CONSTEXPR inline reverse_iterator rend(){return reverse_iterator(begin());}
+
 		/**
 		 * @brief      Const_reverse iterator the end of the array.
 		 *
 		 * @return     Const_reverse iterator the end of the array.
 		 */
-		inline const_reverse_iterator rbegin() const {return reverse_iterator(cend());}
+		FAKE_CONSTEXPR inline const_reverse_iterator rbegin() const {return const_reverse_iterator(cend());}
 		/**
 		 * @brief      Const_reverse iterator the start of the array.
 		 *
 		 * @return     Const_reverse iterator the start of the array.
 		 */
-		inline const_reverse_iterator rend() const {return reverse_iterator(cbegin());}
+		FAKE_CONSTEXPR inline const_reverse_iterator rend() const {return const_reverse_iterator(cbegin());}
 
 		/**
 		 * @brief      Const_reverse iterator the end of the array.
 		 *
 		 * @return     Const_reverse iterator the end of the array.
 		 */
-		inline const_reverse_iterator crbegin() const {return reverse_iterator(cend());}
+		FAKE_CONSTEXPR inline const_reverse_iterator crbegin() const {return const_reverse_iterator(cend());}
 		/**
 		 * @brief      Const_reverse iterator the start of the array.
 		 *
 		 * @return     Const_reverse iterator the start of the array.
 		 */
-		inline const_reverse_iterator crend() const {return reverse_iterator(cbegin());}
+		FAKE_CONSTEXPR inline const_reverse_iterator crend() const {return const_reverse_iterator(cbegin());}
 
 		// Capacity
 
@@ -475,41 +1094,54 @@ namespace fake{
 		 *
 		 * @return     Size.
 		 */
-		inline size_type size() const {return size_;}
+		FAKE_CONSTEXPR inline size_type size() const {return array_end_ - array_start_;}
 		//max_size
-		
+
 		/**
 		 * @brief      Changes the size of the vector. If the new size is lower or equal to the current size destroys out of range elements and the capacity stays untouched.
-		 * If the size is greater than the current size allocates memory for n more elements.
+		 * If the size is greater than the current size allocates memory for and value-initializes the new elements.
 		 *
 		 * @param[in]  n     New vector size
 		 */
-		void resize (size_type n){
-			if (n <= size_){
-				destroy_elements(array_start_ + n, size_ - n);
-				size_ = n;
+		FAKE_CONSTEXPR void resize (size_type n){
+			const size_type old_size = size();
+			if (n <= old_size){
+				destroy_elements(array_start_ + n, old_size - n);
+				array_end_ = array_start_ + n;
+				shrink_if_sparse();
 			} else {
-				increase_array(std::max(n, 2*capacity_));
-				size_ = n;
+				if (n > capacity()){
+					const size_type new_capacity = std::max(n, 2*capacity());
+					if (increase_array_zeroed(new_capacity, std::integral_constant<bool, element_traits::zero_allocate>())){
+						array_end_ = array_start_ + n;
+						return;
+					}
+					increase_array(new_capacity);
+				}
+				construct_elements(array_end_, n - old_size);
+				array_end_ = array_start_ + n;
 			}
 		}
 
 		/**
 		 * @brief      Changes the size of the vector. If the new size is lower or equal to the current size destroys out of range elements and the capacity stays untouched.
-		 * If the size is greater than the current size allocates memory and constructs n elements with value val.
+		 * If the size is greater than the current size allocates memory and constructs the new elements with value val.
 		 *
 		 * @param[in]  n     New vector size
 		 * @param[in]  val   Value to fill empty space
 		 */
-		void resize (size_type n, const value_type& val){
-			if (n <= size_){
-				destroy_elements(array_start_ + n, size_ - n);
-				size_ = n;
+		FAKE_CONSTEXPR void resize (size_type n, const value_type& val){
+			const size_type old_size = size();
+			if (n <= old_size){
+				destroy_elements(array_start_ + n, old_size - n);
+				array_end_ = array_start_ + n;
+				shrink_if_sparse();
 			} else {
-				increase_array(std::max(n, 2*capacity_));
-				construct_elements(end(), array_range_end_ - array_end_, val);
-				size_ = n;
-				set_pointers();
+				const value_type copy(val);
+				if (n > capacity())
+					increase_array(std::max(n, 2*capacity()));
+				construct_elements(array_end_, n - old_size, copy);
+				array_end_ = array_start_ + n;
 			}
 		}
 
@@ -518,50 +1150,79 @@ namespace fake{
 		 *
 		 * @return     Capacity.
 		 */
-		inline size_type capacity() const {return capacity_;}
+		FAKE_CONSTEXPR inline size_type capacity() const {return array_range_end_ - array_start_;}
 
 		/**
 		 * @brief      Checks if the vector is empty.
 		 *
 		 * @return     True if the vector is empty, False otherwise.
 		 */
-		inline bool empty(){return size_ == 0;}
+		FAKE_CONSTEXPR inline bool empty() const {return array_end_ == array_start_;}
 
 		/**
 		 * @brief      Increases the capacity of the array if n is greater than the current capacity, does nothing otherwise.
 		 *
 		 * @param[in]  n     New capacity.
 		 */
-		void reserve(size_type n){
-			if (n > capacity_)
+		FAKE_CONSTEXPR void reserve(size_type n){
+			if (n > capacity())
 				increase_array(n);
 		}
 
 		/**
 		 * @brief      Reduces the capacity to equal the size.
 		 */
-		void shrink_to_fit(){
-			increase_array(size_);
+		FAKE_CONSTEXPR void shrink_to_fit(){
+			if (capacity() > size())
+				increase_array(size());
+		}
+
+#if defined(__unix__)
+		/**
+		 * @brief      Gives the physical memory of the unused capacity back to the system without moving the elements
+		 * or changing the capacity (madvise). Only whole pages past the last element are released, so this pays off
+		 * for large arrays with much spare capacity. The capacity is usable as before, released pages are backed
+		 * again when written.
+		 *
+		 * @param[in]  lazy  Let the system take the pages only when it needs memory (MADV_FREE), which is cheaper
+		 * when the capacity is likely to be used again soon
+		 *
+		 * @return     Number of bytes released.
+		 */
+		size_type release_unused(bool lazy = false){
+			return detail::release_pages(array_end_, array_range_end_, lazy);
+		}
+
+		/**
+		 * @brief      Gives memory back while the vector is idle: an empty vector frees its array, any other one
+		 * releases the pages of its unused capacity. Called for registered vectors by fake::trim_all.
+		 */
+		void trim(){
+			if (empty())
+				shrink_to_fit();
+			else
+				release_unused();
 		}
+#endif
 
 		// Element access
 
 		/**
-		 * @brief      Overloads the [] operator to work like in an array. 
+		 * @brief      Overloads the [] operator to work like in an array.
 		 *
 		 * @param[in]  n     Index of an element in the vector
 		 *
 		 * @return     Reference to the n'th element in the vector.
 		 */
-		reference operator[](size_type n){return *(array_start_ + n);}
+		FAKE_CONSTEXPR reference operator[](size_type n){return *(array_start_ + n);}
 		/**
-		 * @brief      Overloads the [] operator to work like in an array. 
+		 * @brief      Overloads the [] operator to work like in an array.
 		 *
 		 * @param[in]  n     Index of an element in the vector
 		 *
 		 * @return     Const_reference to the n'th element in the vector.
 		 */
-		const_reference operator[](size_type n) const {return *(array_start_ + n);}
+		FAKE_CONSTEXPR const_reference operator[](size_type n) const {return *(array_start_ + n);}
 
 		/**
 		 * @brief      Function to access an element in the array. Checks whether the requested element is the the range of the vector or not. If the element is out of range
@@ -571,8 +1232,8 @@ namespace fake{
 		 *
 		 * @return    Reference to the n'th element in the vector.
 		 */
-		reference at(size_type n){
-			if (n < capacity_ && n > 0)
+		FAKE_CONSTEXPR reference at(size_type n){
+			if (n < size())
 				return *(array_start_ + n);
 			else throw std::out_of_range("out of vector range.");
 		}
@@ -586,8 +1247,8 @@ namespace fake{
 		 *
 		 * @return    Const_reference to the n'th element in the vector.
 		 */
-		const_reference at(size_type n) const {
-			if (n < capacity_ && n > 0)
+		FAKE_CONSTEXPR const_reference at(size_type n) const {
+			if (n < size())
 				return *(array_start_ + n);
 			else throw std::out_of_range("out of vector range.");
 		}
@@ -597,7 +1258,7 @@ namespace fake{
 		 *
 		 * @return     Reference to the start of the array
 		 */
-		inline reference front(){
+		FAKE_CONSTEXPR inline reference front(){
 			return *(array_start_);
 		}
 
@@ -606,24 +1267,24 @@ namespace fake{
 		 *
 		 * @return     Const_reference to the start of the array
 		 */
-		inline const_reference front() const {
+		FAKE_CONSTEXPR inline const_reference front() const {
 			return *(array_start_);
 		}
 		/**
-		 * @brief      Reference to the end of the array
+		 * @brief      Reference to the last element of the array
 		 *
-		 * @return     Reference to the end of the array
+		 * @return     Reference to the last element of the array
 		 */
-		inline reference back(){
-			return *(array_end_);
+		FAKE_CONSTEXPR inline reference back(){
+			return *(array_end_ - 1);
 		}
 		/**
-		 * @brief      Const_reference to the end of the array
+		 * @brief      Const_reference to the last element of the array
 		 *
-		 * @return     Const_reference to the end of the array
+		 * @return     Const_reference to the last element of the array
 		 */
-		inline const_reference back() const {
-			return *(array_end_);
+		FAKE_CONSTEXPR inline const_reference back() const {
+			return *(array_end_ - 1);
 		}
 
 		/**
@@ -631,7 +1292,24 @@ namespace fake{
 		 *
 		 * @return    	Pointer to the vector array.
 		 */
-		inline pointer data() const {return array_;}
+		FAKE_CONSTEXPR inline pointer data(){return array_start_;}
+		/**
+		 * @brief      Returns the pointer to the vector array.
+		 *
+		 * @return    	Const_pointer to the vector array.
+		 */
+		FAKE_CONSTEXPR inline const_pointer data() const {return array_start_;}
+
+		/**
+		 * @brief      Splits the elements into contiguous spans of n elements, the last one can be shorter.
+		 * The spans are invalidated like iterators.
+		 *
+		 * @param[in]  n     Elements per span
+		 *
+		 * @return     Range of spans
+		 */
+		inline span_chunks<value_type> chunks(size_type n){return span_chunks<value_type>(data(), size(), n);}
+		inline span_chunks<const value_type> chunks(size_type n) const {return span_chunks<const value_type>(data(), size(), n);}
 
 		// Modifiers
 
@@ -645,17 +1323,10 @@ namespace fake{
 		 * @tparam     <unnamed>      { description }
 		 */
 		template <class InputIterator, typename = std::_RequireInputIter<InputIterator>>
-		void assign(InputIterator first, InputIterator last){
-			if (last - first <= capacity_){
-				size_ = last-first;
-				construct_elements(first, last, array_start_);
-				set_pointers();
-			} else {
-				size_ = last-first;
-				increase_array(last-first);
-				construct_elements(first, last, array_start_);
-				set_pointers();
-			}
+		FAKE_CONSTEXPR void assign(InputIterator first, InputIterator last){
+			destroy_elements(array_start_, size());
+			array_end_ = array_start_;
+			append_range(first, last);
 		}
 
 		/**
@@ -664,17 +1335,13 @@ namespace fake{
 		 * @param[in]  n     Number of elements
 		 * @param[in]  val   Value of the elements
 		 */
-		void assign (size_type n, const_reference val){
-			if (n <= capacity_){
-				size_ = n;
-				construct_elements(array_, n, val);
-				set_pointers();
-			} else {
-				size_ = n;
-				increase_array(n);
-				construct_elements(array_, n, val);
-				set_pointers();
-			}
+		FAKE_CONSTEXPR void assign (size_type n, const_reference val){
+			const value_type copy(val);
+			destroy_elements(array_start_, size());
+			array_end_ = array_start_;
+			reserve(n);
+			construct_elements(array_start_, n, copy);
+			array_end_ = array_start_ + n;
 		}
 
 		/**
@@ -682,17 +1349,8 @@ namespace fake{
 		 *
 		 * @param[in]  il    The initializer list
 		 */
-		void assign (std::initializer_list<value_type> il){
-			if (il.size() <= capacity_){
-				size_ = il.size();
-				construct_elements(il.begin(), il.end(), array_start_);
-				set_pointers();
-			} else {
-				size_ = il.size();
-				increase_array(il.size());
-				s(il.begin(), il.end(), begin());
-				set_pointers();
-			}
+		FAKE_CONSTEXPR void assign (std::initializer_list<value_type> il){
+			assign(il.begin(), il.end());
 		}
 
 		/**
@@ -700,17 +1358,8 @@ namespace fake{
 		 *
 		 * @param[in]  val   The value
 		 */
-		void push_back(const value_type& val){
-			if (array_end_ != array_range_end_){
-				allocator_.construct(array_end_, val);
-				size_++;
-				set_pointers();
-			} else {
-				increase_array(std::max(1, static_cast<int>(capacity_*2)));
-				allocator_.construct(array_end_, val);
-				size_++;
-				set_pointers();
-			}
+		FAKE_CONSTEXPR void push_back(const value_type& val){
+			emplace_back(val);
 		}
 
 		/**
@@ -718,26 +1367,139 @@ namespace fake{
 		 *
 		 * @param[in]  val  The value
 		 */
-		void push_back(value_type&& val){
-			if (array_end_ != array_range_end_){
-				allocator_.construct(array_end_, val);
-				size_++;
-				set_pointers();
-			} else {
-				increase_array(std::max(1, static_cast<int>(capacity_*2)));
-				allocator_.construct(array_end_, val);
-				size_++;
-				set_pointers();
+		FAKE_CONSTEXPR void push_back(value_type&& val){
+			emplace_back(std::move(val));
+		}
+
+		/**
+		 * @brief      Adds a value to the end of a vector without checking the capacity.
+		 * The caller must have reserved enough space beforehand, this is only asserted in debug builds.
+		 *
+		 * @param[in]  val   The value
+		 */
+		FAKE_CONSTEXPR void unchecked_push_back(const value_type& val){
+			unchecked_emplace_back(val);
+		}
+
+		/**
+		 * @brief      Moves a value to the end of a vector without checking the capacity.
+		 *
+		 * @param[in]  val   The value
+		 */
+		FAKE_CONSTEXPR void unchecked_push_back(value_type&& val){
+			unchecked_emplace_back(std::move(val));
+		}
+
+		/**
+		 * @brief      Constructs an element at the end of the vector without checking the capacity.
+		 * The caller must have reserved enough space beforehand, this is only asserted in debug builds.
+		 *
+		 * @param[in]  args       Arguments to forward to the constructor of the element
+		 *
+		 * @tparam     Args       Arguments template
+		 */
+		template <class... Args>
+		FAKE_CONSTEXPR void unchecked_emplace_back(Args&&... args){
+			assert(array_end_ != array_range_end_ && "unchecked_emplace_back past capacity");
+			construct_element(array_end_, std::forward<Args>(args)...);
+			++array_end_;
+		}
+
+		/**
+		 * @brief      Scoped writer appending to the reserved capacity of a vector. It keeps its own end pointer
+		 * and commits the new size to the vector once, when it goes out of scope.
+		 * The vector must not be touched through other members while the writer is alive.
+		 */
+		class unchecked_back_inserter{
+		private:
+			/**
+			 * Vector being written to.
+			 */
+			vector* vector_;
+			/**
+			 * Pointer to the next element to construct.
+			 */
+			pointer cursor_;
+		public:
+			explicit
+			FAKE_CONSTEXPR unchecked_back_inserter(vector& x) :
+				vector_(&x),
+				cursor_(x.array_end_)
+				{};
+
+			unchecked_back_inserter(const unchecked_back_inserter&) = delete;
+			unchecked_back_inserter& operator=(const unchecked_back_inserter&) = delete;
+
+			FAKE_CONSTEXPR unchecked_back_inserter(unchecked_back_inserter&& x) noexcept :
+				vector_(x.vector_),
+				cursor_(x.cursor_)
+				{
+					x.vector_ = nullptr;
+				};
+
+			/**
+			 * @brief      Commits the elements written so far to the vector.
+			 */
+			FAKE_CONSTEXPR ~unchecked_back_inserter(){
+				if (vector_)
+					vector_->array_end_ = cursor_;
+			}
+
+			/**
+			 * @brief      Adds a value to the end of the vector.
+			 *
+			 * @param[in]  val   The value
+			 */
+			FAKE_CONSTEXPR void push_back(const value_type& val){
+				emplace_back(val);
+			}
+
+			/**
+			 * @brief      Moves a value to the end of the vector.
+			 *
+			 * @param[in]  val   The value
+			 */
+			FAKE_CONSTEXPR void push_back(value_type&& val){
+				emplace_back(std::move(val));
+			}
+
+			/**
+			 * @brief      Constructs an element at the end of the vector.
+			 *
+			 * @param[in]  args       Arguments to forward to the constructor of the element
+			 *
+			 * @tparam     Args       Arguments template
+			 */
+			template <class... Args>
+			FAKE_CONSTEXPR void emplace_back(Args&&... args){
+				assert(cursor_ != vector_->array_range_end_ && "unchecked_back_inserter past capacity");
+				vector_->construct_element(cursor_, std::forward<Args>(args)...);
+				++cursor_;
 			}
+
+			/**
+			 * @brief      Number of elements that can still be written without exceeding the capacity.
+			 *
+			 * @return     Remaining capacity.
+			 */
+			FAKE_CONSTEXPR inline size_type remaining() const {return vector_->array_range_end_ - cursor_;}
+		};
+
+		/**
+		 * @brief      Creates a scoped writer that appends to the reserved capacity without capacity checks.
+		 *
+		 * @return     The writer. The size of the vector is updated when it is destroyed.
+		 */
+		FAKE_CONSTEXPR unchecked_back_inserter back_inserter_unchecked(){
+			return unchecked_back_inserter(*this);
 		}
 
 		/**
 		 * @brief      Destroys the last item in the vector.
 		 */
-		void pop_back(){
-			allocator_.destroy(array_end_);
-			size_--;
-			set_pointers();
+		FAKE_CONSTEXPR void pop_back(){
+			remove_last();
+			shrink_if_sparse();
 		}
 
 		/**
@@ -748,15 +1510,9 @@ namespace fake{
 		 *
 		 * @return     An iterator to the inserted value.
 		 */
-		iterator insert (const_iterator position, const value_type& val){
-			const difference_type distance = position - cbegin();
-			if (array_end_ == array_range_end_)
-				increase_array(std::max(1, static_cast<int>(capacity_*2)));
-			size_++;
-			iterator it = begin() + distance;
-			construct_elements(it, end(), array_start_ + distance + 1);
-			allocator_.construct(array_start_ + distance, val);
-			return it;
+		FAKE_CONSTEXPR iterator insert (const_iterator position, const value_type& val){
+			value_type copy(val);
+			return insert(position, std::move(copy));
 		}
 
 		/**
@@ -767,15 +1523,10 @@ namespace fake{
 		 *
 		 * @return     An iterator to the inserted value.
 		 */
-		iterator insert(const_iterator position, value_type&& val){
+		FAKE_CONSTEXPR iterator insert(const_iterator position, value_type&& val){
 			const difference_type distance = position - cbegin();
-			if (array_end_ == array_range_end_)
-				increase_array(std::max(1, static_cast<int>(capacity_*2)));
-			size_++;
-			iterator it = begin() + distance;
-			construct_elements(it, end(), array_start_ + distance + 1);
-			allocator_.construct(array_start_ + distance, val);
-			return it;
+			construct_element(make_gap(distance, 1), std::move(val));
+			return begin() + distance;
 		}
 
 		/**
@@ -787,15 +1538,11 @@ namespace fake{
 		 *
 		 * @return     Iterator to the first of the inserted elements.
 		 */
-		iterator insert(const_iterator position, size_type count, const value_type& val){
+		FAKE_CONSTEXPR iterator insert(const_iterator position, size_type count, const value_type& val){
 			const difference_type distance = position - cbegin();
-			if (size_ + count > capacity_)
-				increase_array(std::max(static_cast<int>(capacity_*2), static_cast<int>(size_ + count)));
-			size_ += count;
-			iterator it = begin() + distance;
-			construct_elements(it, end(), array_start_ + distance + count);
-			construct_elements(it, count, val);
-			return it;
+			const value_type copy(val);
+			construct_elements(make_gap(distance, count), count, copy);
+			return begin() + distance;
 		}
 
 		/**
@@ -811,16 +1558,57 @@ namespace fake{
 		 * @return    Iterator to the first of the inserted elements
 		 */
 		template <class InputIterator, typename = std::_RequireInputIter<InputIterator>>
-		iterator insert(const_iterator position, InputIterator first, InputIterator last){
+		FAKE_CONSTEXPR iterator insert(const_iterator position, InputIterator first, InputIterator last){
 			const difference_type distance = position - cbegin();
-			const difference_type count = last - first;
-			if (size_ + count > capacity_)
-				increase_array(std::max(static_cast<int>(capacity_*2), static_cast<int>(size_ + count)));
-			size_ += count;
-			iterator it = begin() + distance;
-			construct_elements(it, end(), array_start_ + distance + count);
-			construct_elements(first, last, array_start_ + distance);
-			return it;
+			insert_elements(distance, first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+			return begin() + distance;
+		}
+
+		/**
+		 * @brief      Inserts the elements of a range to a position pointed by an iterator position.
+		 * Forward ranges are measured first so the vector reallocates at most once.
+		 *
+		 * @param[in]  position  The position
+		 * @param[in]  range     Range of elements, anything with begin() and end()
+		 *
+		 * @tparam     Range     Range type
+		 *
+		 * @return     Iterator to the first of the inserted elements
+		 */
+		template <class Range>
+		FAKE_CONSTEXPR iterator insert_range(const_iterator position, Range&& range){
+			using std::begin;
+			using std::end;
+			return insert(position, begin(range), end(range));
+		}
+
+		/**
+		 * @brief      Appends the elements from range [first, last) to the end of the vector.
+		 * Forward ranges are measured first so the vector reallocates at most once, input ranges are pushed one by one.
+		 *
+		 * @param[in]  first          Iterator to the start of the range
+		 * @param[in]  last           Iterator to the end of the range
+		 *
+		 * @tparam     InputIterator  Template argument to only allow iterators to pass
+		 * @tparam     <unnamed>      { description }
+		 */
+		template <class InputIterator, typename = std::_RequireInputIter<InputIterator>>
+		FAKE_CONSTEXPR void append_range(InputIterator first, InputIterator last){
+			append_elements(first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+		}
+
+		/**
+		 * @brief      Appends the elements of a range to the end of the vector.
+		 *
+		 * @param[in]  range  Range of elements, anything with begin() and end()
+		 *
+		 * @tparam     Range  Range type
+		 */
+		template <class Range>
+		FAKE_CONSTEXPR void append_range(Range&& range){
+			using std::begin;
+			using std::end;
+			append_range(begin(range), end(range));
 		}
 
 		/**
@@ -831,16 +1619,10 @@ namespace fake{
 		 *
 		 * @return     Iterator to the first of the inserted elements
 		 */
-		iterator insert(const_iterator position, std::initializer_list<value_type> il){
+		FAKE_CONSTEXPR iterator insert(const_iterator position, std::initializer_list<value_type> il){
 			const difference_type distance = position - cbegin();
-			const difference_type count = il.end() - il.begin();
-			if (size_ + count > capacity_)
-				increase_array(std::max(static_cast<int>(capacity_*2), static_cast<int>(size_ + count)));
-			size_ += count;
-			iterator it = begin() + distance;
-			construct_elements(it, end(), array_start_ + distance + count);
-			construct_elements(il.begin(), il.end(), array_start_ + distance);
-			return it;
+			construct_elements(il.begin(), il.end(), make_gap(distance, il.size()));
+			return begin() + distance;
 		}
 
 		/**
@@ -850,13 +1632,13 @@ namespace fake{
 		 *
 		 * @return     Iterator to the removed element.
 		 */
-		iterator erase(const_iterator position){
+		FAKE_CONSTEXPR iterator erase(const_iterator position){
 			const difference_type distance = position - cbegin();
 			iterator it = begin() + distance;
-			construct_elements(it + 1, end(), array_start_ + distance);
-			size_--;
-			return it;
-
+			std::move(it + 1, end(), it);
+			remove_last();
+			shrink_if_sparse();
+			return begin() + distance;
 		}
 
 		/**
@@ -867,15 +1649,138 @@ namespace fake{
 		 *
 		 * @return     Iterator to the first of the removes elements.
 		 */
-		iterator erase(const_iterator first, const_iterator last){
+		FAKE_CONSTEXPR iterator erase(const_iterator first, const_iterator last){
 			const difference_type distance = first - cbegin();
+			if (first == last)
+				return begin() + distance;
 			const difference_type distance_first_last = last - cbegin();
 			iterator it_first = begin() + distance;
 			iterator it_last = begin() + distance_first_last;
-			construct_elements(it_last, end(), array_start_ + distance);
-			size_ -= last-first;
-			return it_first;
+			const size_type count = last - first;
+			std::move(it_last, end(), it_first);
+			destroy_elements(array_end_ - count, count);
+			array_end_ -= count;
+			shrink_if_sparse();
+			return begin() + distance;
+		}
+
+		/**
+		 * @brief      Inserts many elements at different positions in a single pass. The final size is computed once,
+		 * the array grows at most once and every existing element is moved at most once.
+		 * In place the elements are merged from the back, after growing they are relocated front to back.
+		 *
+		 * @param[in]  batch  Bidirectional range of (position, value) pairs, e.g. std::pair<size_type, value_type>.
+		 * Positions are indices in the vector before the call, in ascending order. Values with equal positions keep their order.
+		 *
+		 * @tparam     Range  Range type
+		 */
+		template <class Range>
+		FAKE_CONSTEXPR void insert_batch(const Range& batch){
+			using std::begin;
+			using std::end;
+			const auto first = begin(batch);
+			const auto last = end(batch);
+			const size_type count = std::distance(first, last);
+			if (count == 0)
+				return;
+			const size_type old_size = size();
+			const size_type new_size = old_size + count;
+
+			if (new_size > capacity()){
+				const size_type new_capacity = std::max(2*capacity(), new_size);
+				pointer new_array = allocate(new_capacity);
+				pointer out = new_array;
+				size_type source = 0;
+				for (auto it = first; it != last; ++it){
+					const size_type position = it->first;
+					assert(source <= position && position <= old_size && "insert_batch needs ascending positions in range");
+					relocate_elements(array_start_ + source, array_start_ + position, out);
+					out += position - source;
+					construct_element(out++, it->second);
+					source = position;
+				}
+				relocate_elements(array_start_ + source, array_end_, out);
+				destroy_relocated(array_start_, old_size);
+				deallocate();
+				set_pointers(new_array, new_size, new_capacity);
+				return;
+			}
 
+			// slots past the old end are raw memory and get constructed, the rest are assigned
+			pointer const old_end = array_end_;
+			pointer out = array_start_ + new_size;
+			pointer source = old_end;
+			auto place = [this, old_end](pointer destination, value_type&& value){
+				if (destination >= old_end)
+					construct_element(destination, std::move(value));
+				else
+					*destination = std::move(value);
+			};
+			for (auto it = last; it != first; ){
+				--it;
+				pointer const position = array_start_ + it->first;
+				assert(position <= source && "insert_batch needs ascending positions in range");
+				while (source != position){
+					--source;
+					place(--out, std::move(*source));
+				}
+				value_type element(it->second);
+				place(--out, std::move(element));
+			}
+			array_end_ = array_start_ + new_size;
+		}
+
+		/**
+		 * @brief      Removes the elements at the given indices in a single pass. Every run of kept elements
+		 * between two removed ones is moved down once, so each element moves at most once.
+		 *
+		 * @param[in]  indices  Range of indices in ascending order, duplicates are ignored
+		 *
+		 * @tparam     Range    Range type
+		 *
+		 * @return     Number of removed elements.
+		 */
+		template <class Range>
+		FAKE_CONSTEXPR size_type erase_indices(const Range& indices){
+			using std::begin;
+			using std::end;
+			auto it = begin(indices);
+			const auto last = end(indices);
+			if (it == last)
+				return 0;
+			pointer out = array_start_ + *it;
+			size_type removed = 0;
+			while (it != last){
+				const size_type index = *it;
+				while (it != last && static_cast<size_type>(*it) == index)
+					++it;
+				const size_type next = it == last ? size() : static_cast<size_type>(*it);
+				assert(index < next && next <= size() && "erase_indices needs ascending indices in range");
+				out = std::move(array_start_ + index + 1, array_start_ + next, out);
+				++removed;
+			}
+			destroy_elements(out, array_end_ - out);
+			array_end_ = out;
+			shrink_if_sparse();
+			return removed;
+		}
+
+		/**
+		 * @brief      Removes an element by moving the last element in its place. Does not keep the order of the elements
+		 * but never shifts the tail.
+		 *
+		 * @param[in]  position  The position
+		 *
+		 * @return     Iterator to the element that took the place of the removed one.
+		 */
+		FAKE_CONSTEXPR iterator swap_erase(const_iterator position){
+			const difference_type distance = position - cbegin();
+			iterator it = begin() + distance;
+			if (it + 1 != end())
+				*it = std::move(back());
+			remove_last();
+			shrink_if_sparse();
+			return begin() + distance;
 		}
 
 		/**
@@ -883,25 +1788,26 @@ namespace fake{
 		 *
 		 * @param      x     Vector to swap the contents with.
 		 */
-		void swap(vector& x){
-			std::swap(capacity_, x.capacity_);
-			std::swap(size_, x.size_);
-			std::swap(array_, x.array_);
-			set_pointers();
-			x.set_pointers();
+		FAKE_CONSTEXPR void swap(vector& x) noexcept {
+			using std::swap;
+			swap(allocator(), x.allocator());
+			swap(array_start_, x.array_start_);
+			swap(array_end_, x.array_end_);
+			swap(array_range_end_, x.array_range_end_);
 		}
 
 		/**
-		 * @brief      Destroys the vectors contents and sets the size to 0.
+		 * @brief      Destroys the vectors contents and sets the size to 0. The capacity is kept, unless the
+		 * allocator asks for shrinking (see fake::shrinking_allocator).
 		 */
-		void clear(){
-			destroy_elements(array_, size_);
-			size_ = 0;
-			set_pointers();
+		FAKE_CONSTEXPR void clear(){
+			destroy_elements(array_start_, size());
+			array_end_ = array_start_;
+			shrink_if_sparse();
 		}
 
 		/**
-		 * @brief      Inserts and constructs an element to the position position. 
+		 * @brief      Inserts and constructs an element to the position position.
 		 *
 		 * @param[in]  position   The position
 		 * @param[in]  args       Arguments to forward to the constructor of the element
@@ -911,15 +1817,9 @@ namespace fake{
 		 * @return     An iterator the inserted element.
 		 */
 		template <class... Args>
-		iterator emplace (const_iterator position, Args&&... args){
-			difference_type distance = position - cbegin();
-			if (array_end_ == array_range_end_)
-				increase_array(std::max(1, static_cast<int>(capacity_*2)));
-			construct_elements(begin() + distance, end(), array_start_ + distance + 1);
-			allocator_.construct(array_start_ + distance, std::forward<Args>(args)...);
-			size_++;
-			set_pointers();
-			return begin() + distance;
+		FAKE_CONSTEXPR iterator emplace (const_iterator position, Args&&... args){
+			value_type element(std::forward<Args>(args)...);
+			return insert(position, std::move(element));
 		}
 
 		/**
@@ -930,12 +1830,12 @@ namespace fake{
 		 * @tparam     Args       Arguments template
 		 */
 		template <class... Args>
-		void emplace_back (Args&&... args){
-			if (array_end_ == array_range_end_)
-				increase_array(std::max(1, static_cast<int>(capacity_*2)));
-			allocator_.construct(array_end_, std::forward<Args>(args)...);
-			size_++;
-			set_pointers();
+		FAKE_CONSTEXPR void emplace_back (Args&&... args){
+			if (__builtin_expect(array_end_ != array_range_end_, 1)){
+				construct_element(array_end_, std::forward<Args>(args)...);
+				++array_end_;
+			} else
+				realloc_emplace_back(std::forward<Args>(args)...);
 		}
 
 		// Allocator
@@ -945,9 +1845,35 @@ namespace fake{
 		 *
 		 * @return     The allocator.
 		 */
-		inline allocator_type get_allocator(){ return allocator_;}
+		FAKE_CONSTEXPR inline allocator_type get_allocator() const { return allocator();}
+
+	};
 
-	}; 
+#if FAKE_HAS_CONSTEXPR_VECTOR
+	/**
+	 * @brief      Runs a vector-building generator at compile time and copies its result into a std::array, which,
+	 * unlike the vector, can outlive the constant evaluation and be stored in a constexpr variable:
+	 * constexpr auto table = fake::freeze([]{fake::vector<int> v; ... return v;});
+	 * The table is then part of the binary and costs nothing at startup.
+	 *
+	 * @param[in]  <unnamed>  Captureless lambda or other default constructible callable returning a fake::vector.
+	 * It is called twice, once for the size and once for the elements.
+	 *
+	 * @tparam     Generator  Generator type
+	 *
+	 * @return     Array holding the elements of the generated vector.
+	 */
+	template <class Generator>
+	consteval auto freeze(Generator){
+		typedef typename decltype(Generator()())::value_type value_type;
+		constexpr std::size_t size = Generator()().size();
+		std::array<value_type, size> table{};
+		const auto vec = Generator()();
+		for (std::size_t i = 0; i < size; ++i)
+			table[i] = vec[i];
+		return table;
+	}
+#endif
 }
 
 #endif
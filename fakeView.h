@@ -0,0 +1,562 @@
+#ifndef FAKEVIEW_H
+#define FAKEVIEW_H
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "fakeVector.h"
+
+namespace fake{
+	/**
+	 * Lazy views over vectors and other ranges, composed with |. A pipeline such as
+	 * vec | views::filter(p) | views::transform(f) | views::take(n) | to<fake::vector>() reads every element once and
+	 * allocates only the result. Views refer to the vectors they were built from, so they must not outlive them.
+	 * Their iterators point into the view, so a view must outlive its iterators as well.
+	 */
+	namespace views{
+		/**
+		 * @brief      Base of every view. Views are copied into the views built on them, anything else is referenced.
+		 */
+		struct view_base{};
+
+		/**
+		 * @brief      Checks whether a range is cheap to copy and refers to elements it does not own. Such ranges are
+		 * copied into views, temporaries included.
+		 */
+		template <class Range>
+		struct is_view : std::is_base_of<view_base, Range> {};
+
+		template <class T>
+		struct is_view<fake::span<T>> : std::true_type {};
+
+		template <class T>
+		struct is_view<fake::span_chunks<T>> : std::true_type {};
+
+		namespace detail{
+			template <class... Types>
+			struct make_void{typedef void type;};
+
+			template <class Range, class Enable = void>
+			struct is_sized : std::false_type {};
+
+			template <class Range>
+			struct is_sized<Range, typename make_void<decltype(std::declval<const Range&>().size())>::type> : std::true_type {};
+
+			template <class Iterator>
+			struct is_random_access : std::is_base_of<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category> {};
+
+			template <class Iterator>
+			inline Iterator advance_bounded(Iterator it, Iterator end, std::size_t n, std::random_access_iterator_tag){
+				const std::size_t left = end - it;
+				return it + (n < left ? n : left);
+			}
+
+			template <class Iterator>
+			inline Iterator advance_bounded(Iterator it, Iterator end, std::size_t n, std::input_iterator_tag){
+				for (; n > 0 && it != end; --n)
+					++it;
+				return it;
+			}
+
+			/**
+			 * @brief      Advances it by n, stopping at end.
+			 */
+			template <class Iterator>
+			inline Iterator advance_bounded(Iterator it, Iterator end, std::size_t n){
+				return advance_bounded(it, end, n, typename std::iterator_traits<Iterator>::iterator_category());
+			}
+		}
+
+		/**
+		 * @brief      Pair of iterators. Wraps vectors at the start of a pipeline and is the element type of chunk.
+		 */
+		template <class Iterator>
+		class iterator_range : public view_base{
+		private:
+			Iterator first_;
+			Iterator last_;
+		public:
+			typedef Iterator iterator;
+			typedef typename std::iterator_traits<Iterator>::value_type value_type;
+
+			iterator_range(Iterator first, Iterator last) :
+				first_(first),
+				last_(last)
+				{};
+
+			inline iterator begin() const {return first_;}
+			inline iterator end() const {return last_;}
+			inline bool empty() const {return first_ == last_;}
+
+			template <class I = Iterator, typename = typename std::enable_if<detail::is_random_access<I>::value>::type>
+			inline std::size_t size() const {return last_ - first_;}
+		};
+
+		/**
+		 * @brief      Views are taken as they are, vectors and other lvalue ranges by reference through an iterator_range.
+		 * Temporary vectors are rejected since the view would outlive them.
+		 */
+		template <class Range>
+		typename std::enable_if<is_view<typename std::decay<Range>::type>::value, typename std::decay<Range>::type>::type
+		all(Range&& range){
+			return std::forward<Range>(range);
+		}
+
+		template <class Range, typename = typename std::enable_if<!is_view<typename std::remove_const<Range>::type>::value>::type>
+		auto all(Range& range) -> iterator_range<decltype(std::begin(range))>{
+			return iterator_range<decltype(std::begin(range))>(std::begin(range), std::end(range));
+		}
+
+		template <class Range>
+		using all_t = decltype(all(std::declval<Range>()));
+
+		/**
+		 * @brief      Applies a function to every element when it is read.
+		 */
+		template <class Base, class Function>
+		class transform_view : public view_base{
+		private:
+			Base base_;
+			Function function_;
+			typedef typename Base::iterator base_iterator;
+		public:
+			class iterator{
+			private:
+				base_iterator it_;
+				const Function* function_;
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef decltype(std::declval<const Function&>()(*std::declval<base_iterator>())) reference;
+				typedef typename std::decay<reference>::type value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : it_(), function_(nullptr) {};
+				iterator(base_iterator it, const Function* function) : it_(it), function_(function) {};
+
+				inline reference operator*() const {return (*function_)(*it_);}
+				inline iterator& operator++(){++it_; return *this;}
+				inline iterator operator++(int){iterator old = *this; ++it_; return old;}
+				inline bool operator==(const iterator& other) const {return it_ == other.it_;}
+				inline bool operator!=(const iterator& other) const {return it_ != other.it_;}
+			};
+			typedef typename iterator::value_type value_type;
+
+			transform_view(const Base& base, const Function& function) :
+				base_(base),
+				function_(function)
+				{};
+
+			inline iterator begin() const {return iterator(base_.begin(), &function_);}
+			inline iterator end() const {return iterator(base_.end(), &function_);}
+
+			template <class B = Base, typename = typename std::enable_if<detail::is_sized<B>::value>::type>
+			inline std::size_t size() const {return base_.size();}
+		};
+
+		/**
+		 * @brief      Skips the elements for which a predicate is false. The size is not known up front.
+		 */
+		template <class Base, class Predicate>
+		class filter_view : public view_base{
+		private:
+			Base base_;
+			Predicate predicate_;
+			typedef typename Base::iterator base_iterator;
+		public:
+			class iterator{
+			private:
+				base_iterator it_;
+				base_iterator end_;
+				const Predicate* predicate_;
+
+				inline void skip(){
+					while (it_ != end_ && !(*predicate_)(*it_))
+						++it_;
+				}
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef typename std::iterator_traits<base_iterator>::reference reference;
+				typedef typename std::iterator_traits<base_iterator>::value_type value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : it_(), end_(), predicate_(nullptr) {};
+				iterator(base_iterator it, base_iterator end, const Predicate* predicate) : it_(it), end_(end), predicate_(predicate) {skip();};
+
+				inline reference operator*() const {return *it_;}
+				inline iterator& operator++(){++it_; skip(); return *this;}
+				inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+				inline bool operator==(const iterator& other) const {return it_ == other.it_;}
+				inline bool operator!=(const iterator& other) const {return it_ != other.it_;}
+			};
+			typedef typename iterator::value_type value_type;
+
+			filter_view(const Base& base, const Predicate& predicate) :
+				base_(base),
+				predicate_(predicate)
+				{};
+
+			inline iterator begin() const {return iterator(base_.begin(), base_.end(), &predicate_);}
+			inline iterator end() const {return iterator(base_.end(), base_.end(), &predicate_);}
+		};
+
+		/**
+		 * @brief      First count elements of a range, or all of them if it is shorter.
+		 */
+		template <class Base>
+		class take_view : public view_base{
+		private:
+			Base base_;
+			std::size_t count_;
+			typedef typename Base::iterator base_iterator;
+		public:
+			class iterator{
+			private:
+				base_iterator it_;
+				std::size_t left_;
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef typename std::iterator_traits<base_iterator>::reference reference;
+				typedef typename std::iterator_traits<base_iterator>::value_type value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : it_(), left_(0) {};
+				iterator(base_iterator it, std::size_t left) : it_(it), left_(left) {};
+
+				inline reference operator*() const {return *it_;}
+				inline iterator& operator++(){++it_; --left_; return *this;}
+				inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+				// The end is reached either after count elements or at the end of the base range.
+				inline bool operator==(const iterator& other) const {return left_ == other.left_ || it_ == other.it_;}
+				inline bool operator!=(const iterator& other) const {return !(*this == other);}
+			};
+			typedef typename iterator::value_type value_type;
+
+			take_view(const Base& base, std::size_t count) :
+				base_(base),
+				count_(count)
+				{};
+
+			inline iterator begin() const {return iterator(base_.begin(), count_);}
+			inline iterator end() const {return iterator(base_.end(), 0);}
+
+			template <class B = Base, typename = typename std::enable_if<detail::is_sized<B>::value>::type>
+			inline std::size_t size() const {return count_ < base_.size() ? count_ : base_.size();}
+		};
+
+		/**
+		 * @brief      Every step-th element, starting with the first.
+		 */
+		template <class Base>
+		class stride_view : public view_base{
+		private:
+			Base base_;
+			std::size_t step_;
+			typedef typename Base::iterator base_iterator;
+		public:
+			class iterator{
+			private:
+				base_iterator it_;
+				base_iterator end_;
+				std::size_t step_;
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef typename std::iterator_traits<base_iterator>::reference reference;
+				typedef typename std::iterator_traits<base_iterator>::value_type value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : it_(), end_(), step_(1) {};
+				iterator(base_iterator it, base_iterator end, std::size_t step) : it_(it), end_(end), step_(step) {};
+
+				inline reference operator*() const {return *it_;}
+				inline iterator& operator++(){it_ = detail::advance_bounded(it_, end_, step_); return *this;}
+				inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+				inline bool operator==(const iterator& other) const {return it_ == other.it_;}
+				inline bool operator!=(const iterator& other) const {return it_ != other.it_;}
+			};
+			typedef typename iterator::value_type value_type;
+
+			stride_view(const Base& base, std::size_t step) :
+				base_(base),
+				step_(step)
+				{
+					assert(step > 0 && "stride step must be positive");
+				};
+
+			inline iterator begin() const {return iterator(base_.begin(), base_.end(), step_);}
+			inline iterator end() const {return iterator(base_.end(), base_.end(), step_);}
+
+			template <class B = Base, typename = typename std::enable_if<detail::is_sized<B>::value>::type>
+			inline std::size_t size() const {return (base_.size() + step_ - 1) / step_;}
+		};
+
+		/**
+		 * @brief      Consecutive iterator_ranges of size elements, the last one can be shorter.
+		 */
+		template <class Base>
+		class chunk_view : public view_base{
+		private:
+			Base base_;
+			std::size_t size_;
+			typedef typename Base::iterator base_iterator;
+		public:
+			class iterator{
+			private:
+				base_iterator it_;
+				base_iterator end_;
+				std::size_t size_;
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef iterator_range<base_iterator> value_type;
+				typedef value_type reference;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : it_(), end_(), size_(1) {};
+				iterator(base_iterator it, base_iterator end, std::size_t size) : it_(it), end_(end), size_(size) {};
+
+				inline reference operator*() const {return value_type(it_, detail::advance_bounded(it_, end_, size_));}
+				inline iterator& operator++(){it_ = detail::advance_bounded(it_, end_, size_); return *this;}
+				inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+				inline bool operator==(const iterator& other) const {return it_ == other.it_;}
+				inline bool operator!=(const iterator& other) const {return it_ != other.it_;}
+			};
+			typedef typename iterator::value_type value_type;
+
+			chunk_view(const Base& base, std::size_t size) :
+				base_(base),
+				size_(size)
+				{
+					assert(size > 0 && "chunk size must be positive");
+				};
+
+			inline iterator begin() const {return iterator(base_.begin(), base_.end(), size_);}
+			inline iterator end() const {return iterator(base_.end(), base_.end(), size_);}
+
+			template <class B = Base, typename = typename std::enable_if<detail::is_sized<B>::value>::type>
+			inline std::size_t size() const {return (base_.size() + size_ - 1) / size_;}
+		};
+
+		/**
+		 * @brief      Pairs of elements at the same position in two ranges, as long as the shorter one.
+		 * Elements are read as std::pair of the references of both ranges, so they can be assigned through.
+		 */
+		template <class First, class Second>
+		class zip_view : public view_base{
+		private:
+			First first_;
+			Second second_;
+			typedef typename First::iterator first_iterator;
+			typedef typename Second::iterator second_iterator;
+		public:
+			class iterator{
+			private:
+				first_iterator first_;
+				second_iterator second_;
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef std::pair<typename std::iterator_traits<first_iterator>::reference,
+					typename std::iterator_traits<second_iterator>::reference> reference;
+				typedef std::pair<typename std::iterator_traits<first_iterator>::value_type,
+					typename std::iterator_traits<second_iterator>::value_type> value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : first_(), second_() {};
+				iterator(first_iterator first, second_iterator second) : first_(first), second_(second) {};
+
+				inline reference operator*() const {return reference(*first_, *second_);}
+				inline iterator& operator++(){++first_; ++second_; return *this;}
+				inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+				// The end is reached at the end of either range.
+				inline bool operator==(const iterator& other) const {return first_ == other.first_ || second_ == other.second_;}
+				inline bool operator!=(const iterator& other) const {return !(*this == other);}
+			};
+			typedef typename iterator::value_type value_type;
+
+			zip_view(const First& first, const Second& second) :
+				first_(first),
+				second_(second)
+				{};
+
+			inline iterator begin() const {return iterator(first_.begin(), second_.begin());}
+			inline iterator end() const {return iterator(first_.end(), second_.end());}
+
+			template <class F = First, class S = Second, typename = typename std::enable_if<detail::is_sized<F>::value && detail::is_sized<S>::value>::type>
+			inline std::size_t size() const {return first_.size() < second_.size() ? first_.size() : second_.size();}
+		};
+
+		/**
+		 * @brief      Pairs of the position and the element, as std::pair<std::size_t, reference>.
+		 */
+		template <class Base>
+		class enumerate_view : public view_base{
+		private:
+			Base base_;
+			typedef typename Base::iterator base_iterator;
+		public:
+			class iterator{
+			private:
+				base_iterator it_;
+				std::size_t index_;
+			public:
+				typedef std::forward_iterator_tag iterator_category;
+				typedef std::pair<std::size_t, typename std::iterator_traits<base_iterator>::reference> reference;
+				typedef std::pair<std::size_t, typename std::iterator_traits<base_iterator>::value_type> value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef void pointer;
+
+				iterator() : it_(), index_(0) {};
+				iterator(base_iterator it, std::size_t index) : it_(it), index_(index) {};
+
+				inline reference operator*() const {return reference(index_, *it_);}
+				inline iterator& operator++(){++it_; ++index_; return *this;}
+				inline iterator operator++(int){iterator old = *this; ++*this; return old;}
+				inline bool operator==(const iterator& other) const {return it_ == other.it_;}
+				inline bool operator!=(const iterator& other) const {return it_ != other.it_;}
+			};
+			typedef typename iterator::value_type value_type;
+
+			explicit
+			enumerate_view(const Base& base) :
+				base_(base)
+				{};
+
+			inline iterator begin() const {return iterator(base_.begin(), 0);}
+			inline iterator end() const {return iterator(base_.end(), 0);}
+
+			template <class B = Base, typename = typename std::enable_if<detail::is_sized<B>::value>::type>
+			inline std::size_t size() const {return base_.size();}
+		};
+
+		// Adaptors hold the arguments of a view until | supplies its range.
+		template <class Function> struct transform_adaptor{Function function;};
+		template <class Predicate> struct filter_adaptor{Predicate predicate;};
+		struct take_adaptor{std::size_t count;};
+		struct stride_adaptor{std::size_t step;};
+		struct chunk_adaptor{std::size_t size;};
+		struct enumerate_adaptor{};
+
+		template <class Function>
+		inline transform_adaptor<Function> transform(Function function){return {function};}
+
+		template <class Predicate>
+		inline filter_adaptor<Predicate> filter(Predicate predicate){return {predicate};}
+
+		inline take_adaptor take(std::size_t count){return {count};}
+		inline stride_adaptor stride(std::size_t step){return {step};}
+		inline chunk_adaptor chunk(std::size_t size){return {size};}
+
+		/**
+		 * @brief      Adaptor for enumerate_view, used as vec | views::enumerate.
+		 */
+		const enumerate_adaptor enumerate = {};
+
+		/**
+		 * @brief      Zips two ranges, see zip_view.
+		 */
+		template <class First, class Second>
+		inline zip_view<all_t<First>, all_t<Second>> zip(First&& first, Second&& second){
+			return zip_view<all_t<First>, all_t<Second>>(all(std::forward<First>(first)), all(std::forward<Second>(second)));
+		}
+
+		template <class Range, class Function>
+		inline transform_view<all_t<Range>, Function> operator|(Range&& range, const transform_adaptor<Function>& adaptor){
+			return transform_view<all_t<Range>, Function>(all(std::forward<Range>(range)), adaptor.function);
+		}
+
+		template <class Range, class Predicate>
+		inline filter_view<all_t<Range>, Predicate> operator|(Range&& range, const filter_adaptor<Predicate>& adaptor){
+			return filter_view<all_t<Range>, Predicate>(all(std::forward<Range>(range)), adaptor.predicate);
+		}
+
+		template <class Range>
+		inline take_view<all_t<Range>> operator|(Range&& range, take_adaptor adaptor){
+			return take_view<all_t<Range>>(all(std::forward<Range>(range)), adaptor.count);
+		}
+
+		template <class Range>
+		inline stride_view<all_t<Range>> operator|(Range&& range, stride_adaptor adaptor){
+			return stride_view<all_t<Range>>(all(std::forward<Range>(range)), adaptor.step);
+		}
+
+		template <class Range>
+		inline chunk_view<all_t<Range>> operator|(Range&& range, chunk_adaptor adaptor){
+			return chunk_view<all_t<Range>>(all(std::forward<Range>(range)), adaptor.size);
+		}
+
+		template <class Range>
+		inline enumerate_view<all_t<Range>> operator|(Range&& range, enumerate_adaptor){
+			return enumerate_view<all_t<Range>>(all(std::forward<Range>(range)));
+		}
+
+		/**
+		 * @brief      Adaptors for to, the second one holds the allocator to build the container with.
+		 */
+		template <template <class...> class Container>
+		struct to_adaptor{};
+
+		template <template <class...> class Container, class Alloc>
+		struct to_allocator_adaptor{Alloc alloc;};
+
+		namespace detail{
+			template <class Range>
+			using range_value_t = typename std::iterator_traits<decltype(std::begin(std::declval<Range&>()))>::value_type;
+
+			template <class Container, class Range>
+			inline void reserve_for(Container& result, const Range& range, std::true_type){result.reserve(range.size());}
+
+			template <class Container, class Range>
+			inline void reserve_for(Container&, const Range&, std::false_type){}
+
+			/**
+			 * @brief      Appends the elements of a range to an empty container, reserving once when the size is known.
+			 */
+			template <class Container, class Range>
+			Container fill(Container result, Range&& range){
+				reserve_for(result, range, is_sized<typename std::decay<Range>::type>());
+				for (auto&& element : range)
+					result.emplace_back(std::forward<decltype(element)>(element));
+				return result;
+			}
+		}
+
+		template <class Range, template <class...> class Container>
+		Container<detail::range_value_t<Range>> operator|(Range&& range, to_adaptor<Container>){
+			return detail::fill(Container<detail::range_value_t<Range>>(), std::forward<Range>(range));
+		}
+
+		template <class Range, template <class...> class Container, class Alloc>
+		Container<detail::range_value_t<Range>, typename std::allocator_traits<Alloc>::template rebind_alloc<detail::range_value_t<Range>>>
+		operator|(Range&& range, const to_allocator_adaptor<Container, Alloc>& adaptor){
+			typedef detail::range_value_t<Range> value_type;
+			typedef typename std::allocator_traits<Alloc>::template rebind_alloc<value_type> allocator_type;
+			return detail::fill(Container<value_type, allocator_type>(allocator_type(adaptor.alloc)), std::forward<Range>(range));
+		}
+	}
+
+	/**
+	 * @brief      Ends a pipeline: range | to<fake::vector>() builds a vector of the elements of the range in one pass.
+	 * The vector is reserved once when the size of the range is known, filter makes it unknown.
+	 */
+	template <template <class...> class Container>
+	inline views::to_adaptor<Container> to(){
+		return {};
+	}
+
+	/**
+	 * @brief      Like to(), building the container with alloc rebound to the element type.
+	 */
+	template <template <class...> class Container, class Alloc>
+	inline views::to_allocator_adaptor<Container, Alloc> to(const Alloc& alloc){
+		return {alloc};
+	}
+}
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef FAKEVMVECTOR_H
+#define FAKEVMVECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "fakeAllocator.h"
+
+namespace fake{
+	/**
+	 * @brief      Vector that never relocates. It reserves address space for its largest possible size up front
+	 * (mmap with PROT_NONE, which takes no memory) and grows by making more of it accessible with mprotect, so the
+	 * elements stay contiguous, growing never copies them and pointers to them stay valid until they are removed.
+	 * The kernel only backs the pages that are written.
+	 *
+	 * @tparam     T     Element type
+	 */
+	template <class T>
+	class vm_vector{
+	public:
+		typedef T 				value_type;
+		typedef T& 				reference;
+		typedef const T& 		const_reference;
+		typedef T* 				pointer;
+		typedef const T* 		const_pointer;
+		typedef T* 				iterator;
+		typedef const T* 		const_iterator;
+		typedef std::size_t 	size_type;
+
+		/**
+		 * Address space reserved by default, 64 GiB.
+		 */
+		static const size_type default_reservation = size_type(1) << 36;
+	private:
+		/**
+		 * Smallest step in which memory is made accessible.
+		 */
+		static const size_type min_commit = size_type(1) << 16;
+
+		/**
+		 * Start of the reservation.
+		 */
+		pointer array_start_;
+		/**
+		 * End of the constructed elements.
+		 */
+		pointer array_end_;
+		/**
+		 * End of the elements that fit in the accessible memory.
+		 */
+		pointer array_range_end_;
+		/**
+		 * Bytes at the start of the reservation that are accessible.
+		 */
+		size_type committed_bytes_;
+		/**
+		 * Size of the reservation in bytes.
+		 */
+		size_type reserved_bytes_;
+
+		/**
+		 * @brief      Makes room for n elements accessible. Accessible memory at least doubles each time, so a
+		 * sequence of push_backs makes a logarithmic number of mprotect calls.
+		 *
+		 * @param[in]  n     Element count
+		 */
+		[[gnu::noinline, gnu::cold]]
+		void commit(size_type n){
+			if (n > max_size())
+				throw std::length_error("vm_vector reservation exhausted.");
+			size_type bytes = 2 * committed_bytes_;
+			if (bytes < min_commit)
+				bytes = min_commit;
+			if (bytes < n * sizeof(T))
+				bytes = n * sizeof(T);
+			bytes = detail::round_to_pages(bytes);
+			if (bytes > reserved_bytes_)
+				bytes = reserved_bytes_;
+			if (::mprotect(reinterpret_cast<char*>(array_start_) + committed_bytes_, bytes - committed_bytes_, PROT_READ | PROT_WRITE) != 0)
+				throw std::bad_alloc();
+			committed_bytes_ = bytes;
+			array_range_end_ = array_start_ + bytes / sizeof(T);
+		}
+
+		void destroy_elements(pointer first, pointer last){
+			if (!std::is_trivially_destructible<T>::value)
+				for (; first != last; ++first)
+					first->~T();
+		}
+
+	public:
+		/**
+		 * @brief      Reserves address space for max_bytes worth of elements. Nothing is accessible yet.
+		 * Throws std::bad_alloc if the address space cannot be reserved.
+		 *
+		 * @param[in]  max_bytes  Size of the reservation in bytes, the vector can never hold more
+		 */
+		explicit
+		vm_vector(size_type max_bytes = default_reservation) :
+			array_start_(nullptr),
+			array_end_(nullptr),
+			array_range_end_(nullptr),
+			committed_bytes_(0),
+			reserved_bytes_(detail::round_to_pages(max_bytes))
+			{
+				array_start_ = static_cast<pointer>(detail::map_pages(reserved_bytes_, PROT_NONE, false));
+				array_end_ = array_range_end_ = array_start_;
+			};
+
+		vm_vector(const vm_vector&) = delete;
+		vm_vector& operator=(const vm_vector&) = delete;
+
+		vm_vector(vm_vector&& x) noexcept :
+			array_start_(x.array_start_),
+			array_end_(x.array_end_),
+			array_range_end_(x.array_range_end_),
+			committed_bytes_(x.committed_bytes_),
+			reserved_bytes_(x.reserved_bytes_)
+			{
+				x.array_start_ = x.array_end_ = x.array_range_end_ = nullptr;
+				x.committed_bytes_ = x.reserved_bytes_ = 0;
+			};
+
+		vm_vector& operator=(vm_vector&& x) noexcept {
+			swap(x);
+			return *this;
+		}
+
+		~vm_vector(){
+			destroy_elements(array_start_, array_end_);
+			detail::unmap_pages(array_start_, reserved_bytes_);
+		}
+
+		void swap(vm_vector& x) noexcept {
+			using std::swap;
+			swap(array_start_, x.array_start_);
+			swap(array_end_, x.array_end_);
+			swap(array_range_end_, x.array_range_end_);
+			swap(committed_bytes_, x.committed_bytes_);
+			swap(reserved_bytes_, x.reserved_bytes_);
+		}
+
+		// Iterators
+
+		inline iterator begin(){return array_start_;}
+		inline iterator end(){return array_end_;}
+		inline const_iterator begin() const {return array_start_;}
+		inline const_iterator end() const {return array_end_;}
+		inline const_iterator cbegin() const {return array_start_;}
+		inline const_iterator cend() const {return array_end_;}
+
+		// Capacity
+
+		inline size_type size() const {return array_end_ - array_start_;}
+		inline bool empty() const {return array_end_ == array_start_;}
+
+		/**
+		 * @brief      Number of elements that fit in the accessible memory.
+		 */
+		inline size_type capacity() const {return array_range_end_ - array_start_;}
+
+		/**
+		 * @brief      Number of elements that fit in the reservation.
+		 */
+		inline size_type max_size() const {return reserved_bytes_ / sizeof(T);}
+
+		/**
+		 * @brief      Makes room for n elements accessible. Never moves the elements.
+		 * Throws std::length_error if n is past max_size().
+		 *
+		 * @param[in]  n     Element count
+		 */
+		void reserve(size_type n){
+			if (n > capacity())
+				commit(n);
+		}
+
+		/**
+		 * @brief      Decommits the memory past the last element: its pages are given back to the system and made
+		 * inaccessible again. The capacity drops to the size rounded up to whole pages, the reservation is kept.
+		 *
+		 * @return     Number of bytes released.
+		 */
+		size_type release_unused(){
+			const size_type keep = detail::round_to_pages(size() * sizeof(T));
+			if (keep >= committed_bytes_)
+				return 0;
+			char* const start = reinterpret_cast<char*>(array_start_);
+			const size_type released = detail::release_pages(start + keep, start + committed_bytes_, false);
+			if (::mprotect(start + keep, committed_bytes_ - keep, PROT_NONE) == 0){
+				committed_bytes_ = keep;
+				array_range_end_ = array_start_ + keep / sizeof(T);
+			}
+			return released;
+		}
+
+		/**
+		 * @brief      Gives memory back while the vector is idle, called for registered vectors by fake::trim_all.
+		 */
+		void trim(){
+			release_unused();
+		}
+
+		/**
+		 * @brief      Changes the size, value-initializing new elements or destroying removed ones.
+		 *
+		 * @param[in]  n     New size
+		 */
+		void resize(size_type n){
+			const size_type old_size = size();
+			if (n <= old_size){
+				destroy_elements(array_start_ + n, array_end_);
+				array_end_ = array_start_ + n;
+			} else {
+				reserve(n);
+				for (; array_end_ != array_start_ + n; ++array_end_)
+					::new(static_cast<void*>(array_end_)) T();
+			}
+		}
+
+		// Element access
+
+		inline reference operator[](size_type n){return array_start_[n];}
+		inline const_reference operator[](size_type n) const {return array_start_[n];}
+
+		reference at(size_type n){
+			if (n < size())
+				return array_start_[n];
+			else throw std::out_of_range("out of vector range.");
+		}
+
+		const_reference at(size_type n) const {
+			if (n < size())
+				return array_start_[n];
+			else throw std::out_of_range("out of vector range.");
+		}
+
+		inline reference front(){return *array_start_;}
+		inline const_reference front() const {return *array_start_;}
+		inline reference back(){return *(array_end_ - 1);}
+		inline const_reference back() const {return *(array_end_ - 1);}
+		inline pointer data(){return array_start_;}
+		inline const_pointer data() const {return array_start_;}
+
+		// Modifiers
+
+		void push_back(const value_type& val){
+			emplace_back(val);
+		}
+
+		void push_back(value_type&& val){
+			emplace_back(std::move(val));
+		}
+
+		/**
+		 * @brief      Constructs an element at the end. Growing makes more memory accessible and never moves
+		 * the elements, so args may refer to an element of the vector.
+		 *
+		 * @param[in]  args       Arguments to forward to the constructor of the element
+		 *
+		 * @tparam     Args       Arguments template
+		 */
+		template <class... Args>
+		void emplace_back(Args&&... args){
+			if (__builtin_expect(array_end_ == array_range_end_, 0))
+				commit(size() + 1);
+			::new(static_cast<void*>(array_end_)) T(std::forward<Args>(args)...);
+			++array_end_;
+		}
+
+		void pop_back(){
+			--array_end_;
+			array_end_->~T();
+		}
+
+		/**
+		 * @brief      Destroys the elements. The memory stays accessible.
+		 */
+		void clear(){
+			destroy_elements(array_start_, array_end_);
+			array_end_ = array_start_;
+		}
+	};
+}
+
+#endif
@@ -1,6 +1,19 @@
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
 #include <vector>
 #include "fakeVector.h"
+#include "fakeAllocator.h"
+#include "fakeAlgorithm.h"
+#include "fakeBudget.h"
+#include "fakeExpression.h"
+#include "fakeIncrementalVector.h"
+#include "fakeLazyVector.h"
+#include "fakePregrowVector.h"
+#include "fakeView.h"
+#include "fakeVmVector.h"
 #include "timer.h"
 
 template <typename T>
@@ -21,12 +34,11 @@ void showStats(const T& vector){
 template <typename T>
 double testFunction(unsigned int testCount){
 	// T b{1, 3, 5, 6, 9, 7, 6, 1, 2, 3, 4, 6};
-	int bl;
 	T a;
 	Timer start;
 	const std::string somestring = "asdgds";
 	for (int i = 0; i < testCount; i++){
-		a.push_back(i);
+		a.push_back(somestring);
 	}	
 	return start.elapsed();
 }
@@ -41,19 +53,1059 @@ double testFunction(unsigned int testCount){
 // 		{};
 // };
 
-int main(){	
+// keeps benchmarked results alive so the optimizer can't drop them
+volatile int sink;
+
+// batch append: push_back loop vs append_range
+double pushBatchFunction(const std::vector<int>& batch, unsigned int repeats){
+	Timer start;
+	for (unsigned int r = 0; r < repeats; r++){
+		fake::vector<int> a;
+		for (int x : batch)
+			a.push_back(x);
+		sink = a[a.size() - 1];
+	}
+	return start.elapsed();
+}
+
+double appendBatchFunction(const std::vector<int>& batch, unsigned int repeats){
+	Timer start;
+	for (unsigned int r = 0; r < repeats; r++){
+		fake::vector<int> a;
+		a.append_range(batch);
+		sink = a[a.size() - 1];
+	}
+	return start.elapsed();
+}
+
+void appendBenchmark(){
+	for (unsigned int n = 64; n <= 1u << 20; n *= 4){
+		const std::vector<int> batch(n, 7);
+		const unsigned int repeats = (1u << 26) / n;
+		const double push = pushBatchFunction(batch, repeats);
+		const double append = appendBatchFunction(batch, repeats);
+		std::cout << "batch " << n << ": push_back " << push << "s append_range " << append << "s "
+			<< (1-append/push)*100 << "\% performance increase" << std::endl;
+	}
+}
+
+// filling reserved capacity: push_back vs unchecked_push_back vs back_inserter_unchecked
+double reservedPushFunction(unsigned int testCount){
+	fake::vector<int> a;
+	a.reserve(testCount);
+	Timer start;
+	for (unsigned int i = 0; i < testCount; i++)
+		a.push_back(i);
+	sink = a[a.size() - 1];
+	return start.elapsed();
+}
+
+double uncheckedPushFunction(unsigned int testCount){
+	fake::vector<int> a;
+	a.reserve(testCount);
+	Timer start;
+	for (unsigned int i = 0; i < testCount; i++)
+		a.unchecked_push_back(i);
+	sink = a[a.size() - 1];
+	return start.elapsed();
+}
+
+double uncheckedWriterFunction(unsigned int testCount){
+	fake::vector<int> a;
+	a.reserve(testCount);
+	Timer start;
+	{
+		auto writer = a.back_inserter_unchecked();
+		for (unsigned int i = 0; i < testCount; i++)
+			writer.push_back(i);
+	}
+	sink = a[a.size() - 1];
+	return start.elapsed();
+}
+
+void uncheckedBenchmark(){
+	const unsigned int operation_count = 1e8;
+	const double checked = reservedPushFunction(operation_count);
+	const double unchecked = uncheckedPushFunction(operation_count);
+	const double writer = uncheckedWriterFunction(operation_count);
+	std::cout << "push_back: " << checked << 's' << std::endl;
+	std::cout << "unchecked_push_back: " << unchecked << "s " << (1-unchecked/checked)*100 << "\% performance increase" << std::endl;
+	std::cout << "back_inserter_unchecked: " << writer << "s " << (1-writer/checked)*100 << "\% performance increase" << std::endl;
+}
+
+// nested vectors: object size and iteration over fake::vector<fake::vector<int>>
+void nestedBenchmark(){
+	const unsigned int outer_count = 1e6;
+	const unsigned int inner_count = 4;
+	const unsigned int test_count = 100;
+	fake::vector<fake::vector<int>> a;
+	a.reserve(outer_count);
+	for (unsigned int i = 0; i < outer_count; i++)
+		a.emplace_back(inner_count, i);
+
+	Timer start;
+	long long sum = 0;
+	for (unsigned int t = 0; t < test_count; t++)
+		for (const auto& inner : a)
+			for (int x : inner)
+				sum += x;
+	sink = sum;
+	const double elapsed = start.elapsed();
+
+	std::cout << "sizeof(fake::vector<int>): " << sizeof(fake::vector<int>) << " bytes" << std::endl;
+	std::cout << "outer array: " << a.capacity() * sizeof(fake::vector<int>) / 1e6 << " MB" << std::endl;
+	std::cout << "nested iteration: " << elapsed / test_count << 's' << std::endl;
+}
+
+// push_back hot path: inspect with objdump -d --no-show-raw-insn main | grep -A30 '<_Z7pushOne'
+template <typename T>
+__attribute__((noinline)) void pushOne(T& a, int value){
+	a.push_back(value);
+}
+
+template <typename T>
+double hotPathFunction(unsigned int testCount){
+	T a;
+	Timer start;
+	for (unsigned int i = 0; i < testCount; i++)
+		pushOne(a, i);
+	sink = a[a.size() - 1];
+	return start.elapsed();
+}
+
+void hotPathBenchmark(){
+	const unsigned int operation_count = 1e8;
+	const double fake = hotPathFunction<fake::vector<int>>(operation_count);
+	const double real = hotPathFunction<std::vector<int>>(operation_count);
+	std::cout << "fake push_back: " << fake << 's' << std::endl;
+	std::cout << "real push_back: " << real << 's' << std::endl;
+	std::cout << (1-fake/real)*100 << "\% performance increase" << std::endl;
+}
+
+// filtering: std::remove_if + erase vs fake::erase_if at different selectivities
+fake::vector<int> filterData(unsigned int n){
+	fake::vector<int> a;
+	a.reserve(n);
+	unsigned int x = 12345;
+	for (unsigned int i = 0; i < n; i++){
+		x = x * 1103515245 + 12345;
+		a.unchecked_push_back((x >> 8) % 100);
+	}
+	return a;
+}
+
+void eraseIfBenchmark(){
+	const unsigned int element_count = 1e8;
+	const fake::vector<int> data = filterData(element_count);
+	for (int selectivity : {1, 10, 50, 90, 99}){
+		auto pred = [selectivity](int x){return x < selectivity;};
+
+		fake::vector<int> a(data);
+		Timer start;
+		a.erase(std::remove_if(a.begin(), a.end(), pred), a.end());
+		const double remove = start.elapsed();
+
+		fake::vector<int> b(data);
+		start.reset();
+		fake::erase_if(b, pred);
+		const double erase = start.elapsed();
+
+		std::cout << "remove " << selectivity << "%: remove_if " << remove << "s erase_if " << erase << "s "
+			<< (1-erase/remove)*100 << "\% performance increase" << std::endl;
+	}
+}
+
+// scattered removals: repeated erase vs erase_indices vs swap_erase
+void eraseIndicesBenchmark(){
+	const unsigned int element_count = 1e6;
+	const unsigned int removal_count = 10000;
+	fake::vector<int> data = filterData(element_count);
+	fake::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < removal_count; i++)
+		indices.push_back(i * (element_count / removal_count) + data[i] % 50);
+
+	fake::vector<int> a(data);
+	Timer start;
+	for (unsigned int i = removal_count; i-- > 0; )
+		a.erase(a.begin() + indices[i]);
+	const double erase = start.elapsed();
+
+	fake::vector<int> b(data);
+	start.reset();
+	b.erase_indices(indices);
+	const double erase_indices = start.elapsed();
+
+	fake::vector<int> c(data);
+	start.reset();
+	for (unsigned int i = removal_count; i-- > 0; )
+		c.swap_erase(c.begin() + indices[i]);
+	const double swap_erase = start.elapsed();
+
+	std::cout << "erase: " << erase << 's' << std::endl;
+	std::cout << "erase_indices: " << erase_indices << "s " << (1-erase_indices/erase)*100 << "\% performance increase" << std::endl;
+	std::cout << "swap_erase: " << swap_erase << "s " << (1-swap_erase/erase)*100 << "\% performance increase" << std::endl;
+}
+
+// inserting 1% new elements into a sorted vector: repeated insert vs insert_batch
+double batchInsertFunction(unsigned int element_count, bool repeated){
+	fake::vector<int> a;
+	for (unsigned int i = 0; i < element_count; i++)
+		a.push_back(2 * i);
+	fake::vector<std::pair<std::size_t, int>> batch;
+	for (unsigned int i = 0; i < element_count / 100; i++)
+		batch.push_back({i * 100 + 37, 2 * (i * 100 + 37) - 1});
+	a.reserve(a.size() + batch.size());
+
+	Timer start;
+	if (repeated){
+		for (std::size_t i = batch.size(); i-- > 0; )
+			a.insert(a.begin() + batch[i].first, batch[i].second);
+	} else
+		a.insert_batch(batch);
+	sink = a[a.size() / 2];
+	return start.elapsed();
+}
+
+void insertBatchBenchmark(){
+	for (unsigned int n : {1000000u, 10000000u}){
+		const double batch = batchInsertFunction(n, false);
+		std::cout << n << " elements: insert_batch " << batch << 's';
+		if (n <= 1000000){
+			const double repeated = batchInsertFunction(n, true);
+			std::cout << " insert " << repeated << "s " << (1-batch/repeated)*100 << "\% performance increase";
+		}
+		std::cout << std::endl;
+	}
+}
+
+// search: std algorithms over fake::vector iterators vs the SIMD versions
+template <typename T>
+void searchFunction(unsigned int element_count){
+	fake::vector<T> a(element_count, T(1));
+	const unsigned int repeats = 1e9 / element_count;
+	const T missing = T(2);
+
+	Timer start;
+	for (unsigned int r = 0; r < repeats; r++)
+		sink = std::find(a.begin(), a.end(), missing) - a.begin();
+	const double std_find = start.elapsed();
+	start.reset();
+	for (unsigned int r = 0; r < repeats; r++)
+		sink = fake::find(a, missing) - a.begin();
+	const double fake_find = start.elapsed();
+
+	start.reset();
+	for (unsigned int r = 0; r < repeats; r++)
+		sink = std::count(a.begin(), a.end(), missing);
+	const double std_count = start.elapsed();
+	start.reset();
+	for (unsigned int r = 0; r < repeats; r++)
+		sink = fake::count(a, missing);
+	const double fake_count = start.elapsed();
+
+	start.reset();
+	for (unsigned int r = 0; r < repeats; r++)
+		sink = std::minmax_element(a.begin(), a.end()).first - a.begin();
+	const double std_minmax = start.elapsed();
+	start.reset();
+	for (unsigned int r = 0; r < repeats; r++)
+		sink = fake::minmax_element(a).first - a.begin();
+	const double fake_minmax = start.elapsed();
+
+	std::cout << element_count << " elements: find " << std_find << "s/" << fake_find
+		<< "s count " << std_count << "s/" << fake_count
+		<< "s minmax_element " << std_minmax << "s/" << fake_minmax << 's' << std::endl;
+}
+
+void searchBenchmark(){
+	std::cout << "std/fake, int:" << std::endl;
+	for (unsigned int n : {1000u, 100000u, 10000000u})
+		searchFunction<int>(n);
+	std::cout << "std/fake, float:" << std::endl;
+	for (unsigned int n : {1000u, 100000u, 10000000u})
+		searchFunction<float>(n);
+}
+
+// radix_sort: std::sort vs radix_sort vs parallel_radix_sort on random keys
+template <typename T>
+void sortFunction(unsigned int element_count){
+	fake::vector<T> data;
+	data.reserve(element_count);
+	unsigned long long state = 12345;
+	for (unsigned int i = 0; i < element_count; i++){
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		const unsigned long long bits = state ^ (state >> 29);
+		data.push_back(std::is_floating_point<T>::value ? T(double(bits >> 11) * 1e-9 - 4e6) : T(bits));
+	}
+
+	fake::vector<T> a = data;
+	Timer start;
+	std::sort(a.begin(), a.end());
+	const double std_time = start.elapsed();
+
+	fake::vector<T> b = data;
+	fake::vector<T> scratch;
+	start.reset();
+	fake::radix_sort(b, scratch);
+	const double radix_time = start.elapsed();
+
+	fake::vector<T> c = data;
+	start.reset();
+	fake::parallel_radix_sort(c);
+	const double parallel_time = start.elapsed();
+
+	sink = a[element_count / 2] == b[element_count / 2] && b[element_count / 2] == c[element_count / 2];
+	std::cout << element_count << " elements: " << std_time << "s/" << radix_time << "s/" << parallel_time << 's' << std::endl;
+}
+
+void sortBenchmark(){
+	std::cout << "std::sort/radix_sort/parallel_radix_sort (" << fake::thread_pool::shared().size() << " threads), uint32_t:" << std::endl;
+	for (unsigned int n : {1000000u, 10000000u, 100000000u})
+		sortFunction<std::uint32_t>(n);
+	std::cout << "uint64_t:" << std::endl;
+	for (unsigned int n : {1000000u, 10000000u, 100000000u})
+		sortFunction<std::uint64_t>(n);
+	std::cout << "float:" << std::endl;
+	for (unsigned int n : {1000000u, 10000000u, 100000000u})
+		sortFunction<float>(n);
+}
+
+// expression: a + b * c and dot(a, b) with temporaries, hand-written loops and expression templates
+fake::vector<float> addTemporary(const fake::vector<float>& a, const fake::vector<float>& b){
+	fake::vector<float> result(a.size());
+	for (std::size_t i = 0; i < a.size(); i++)
+		result[i] = a[i] + b[i];
+	return result;
+}
+
+fake::vector<float> multiplyTemporary(const fake::vector<float>& a, const fake::vector<float>& b){
+	fake::vector<float> result(a.size());
+	for (std::size_t i = 0; i < a.size(); i++)
+		result[i] = a[i] * b[i];
+	return result;
+}
+
+void expressionFunction(unsigned int element_count){
+	fake::vector<float> a(element_count), b(element_count), c(element_count);
+	for (unsigned int i = 0; i < element_count; i++){
+		a[i] = i % 17;
+		b[i] = i % 5 + 0.5f;
+		c[i] = i % 3 - 1.f;
+	}
+	const unsigned int repeats = 1e9 / element_count;
+	fake::vector<float> r(element_count);
+
+	Timer start;
+	for (unsigned int k = 0; k < repeats; k++){
+		r = addTemporary(a, multiplyTemporary(b, c));
+		sink = r[k % element_count];
+	}
+	const double temporary = start.elapsed();
+	start.reset();
+	for (unsigned int k = 0; k < repeats; k++){
+		for (unsigned int i = 0; i < element_count; i++)
+			r[i] = a[i] + b[i] * c[i];
+		sink = r[k % element_count];
+	}
+	const double loop = start.elapsed();
+	start.reset();
+	for (unsigned int k = 0; k < repeats; k++){
+		r = a + b * c;
+		sink = r[k % element_count];
+	}
+	const double expression = start.elapsed();
+
+	start.reset();
+	for (unsigned int k = 0; k < repeats; k++){
+		float total = 0;
+		for (unsigned int i = 0; i < element_count; i++)
+			total += a[i] * b[i];
+		sink = total;
+	}
+	const double dot_loop = start.elapsed();
+	start.reset();
+	for (unsigned int k = 0; k < repeats; k++)
+		sink = fake::dot(a, b);
+	const double dot_expression = start.elapsed();
+
+	std::cout << element_count << " elements: a + b * c " << temporary << "s/" << loop << "s/" << expression
+		<< "s dot " << dot_loop << "s/" << dot_expression << 's' << std::endl;
+}
+
+void expressionBenchmark(){
+	std::cout << "temporaries/loop/expression, float:" << std::endl;
+	for (unsigned int n : {1000u, 100000u, 10000000u})
+		expressionFunction(n);
+}
+
+// kernels: GB/s of every fake::simd kernel on each instruction set level the CPU supports
+template <typename Function>
+double kernelThroughput(std::size_t bytes_per_call, Function function){
+	const unsigned int repeats = 2e9 / bytes_per_call + 1;
+	Timer start;
+	for (unsigned int r = 0; r < repeats; r++)
+		function();
+	return double(bytes_per_call) * repeats / start.elapsed() / 1e9;
+}
+
+void kernelFunction(std::size_t element_count){
+	fake::vector<float> x(element_count), y(element_count), z(element_count);
+	for (std::size_t i = 0; i < element_count; i++){
+		x[i] = float(i % 1000) - 500.f;
+		y[i] = float(i % 7);
+	}
+	fake::vector<int> integers(element_count);
+	fake::vector<fake::simd::half> halves(element_count);
+	fake::vector<std::size_t> counts(64);
+	const std::size_t n = element_count;
+	const std::size_t f = sizeof(float);
+
+	std::cout << element_count << " floats:" << std::endl;
+	const fake::simd::isa levels[] = {fake::simd::isa::sse2, fake::simd::isa::avx2, fake::simd::isa::avx512};
+	const char* names[] = {"sse2", "avx2", "avx512"};
+	for (int level = 0; level < 3; level++){
+		if (levels[level] > fake::simd::detected_isa())
+			break;
+		fake::simd::limit_isa(levels[level]);
+		std::cout << "  " << names[level] << " GB/s:"
+			<< " axpy " << kernelThroughput(3*n*f, [&]{fake::simd::axpy(1e-6f, x.data(), y.data(), n);})
+			<< " dot " << kernelThroughput(2*n*f, [&]{sink = fake::simd::dot(x.data(), y.data(), n);})
+			<< " sum " << kernelThroughput(n*f, [&]{sink = fake::simd::sum(x.data(), n);})
+			<< " prefix_sum " << kernelThroughput(2*n*f, [&]{sink = fake::simd::prefix_sum(x.data(), z.data(), n);})
+			<< " clamp " << kernelThroughput(2*n*f, [&]{fake::simd::clamp(x.data(), z.data(), n, -100.f, 100.f);})
+			<< " float->int " << kernelThroughput(2*n*f, [&]{fake::simd::convert(x.data(), integers.data(), n);})
+			<< " float->half " << kernelThroughput(n*(f + 2), [&]{fake::simd::convert(x.data(), halves.data(), n);})
+			<< " half->float " << kernelThroughput(n*(f + 2), [&]{fake::simd::convert(halves.data(), z.data(), n);})
+			<< " minmax " << kernelThroughput(n*f, [&]{sink = fake::simd::minmax(x.data(), n).max;})
+			<< " histogram " << kernelThroughput(n*f, [&]{fake::simd::histogram(x.data(), n, -500.f, 500.f, counts.data(), 64);})
+			<< std::endl;
+	}
+	fake::simd::limit_isa(fake::simd::isa::avx512);
+}
+
+void kernelBenchmark(){
+	for (std::size_t n : {std::size_t(1) << 14, std::size_t(1) << 24})
+		kernelFunction(n);
+}
+
+// scan: counts to offsets with std::partial_sum against fake::exclusive_scan on pools of 1, 2 and 4 threads
+void scanFunction(std::size_t element_count){
+	fake::vector<unsigned int> counts(element_count);
+	for (std::size_t i = 0; i < element_count; i++)
+		counts[i] = i % 13;
+	const int repeats = 1e9 / element_count + 1;
+
+	Timer start;
+	for (int r = 0; r < repeats; r++){
+		std::partial_sum(counts.begin(), counts.end(), counts.begin());
+		sink = counts[element_count - 1];
+	}
+	const double sequential = start.elapsed() / repeats;
+	std::cout << element_count << " elements: partial_sum " << sequential << 's';
+
+	for (unsigned int threads : {1u, 2u, 4u}){
+		fake::thread_pool pool(threads);
+		start.reset();
+		for (int r = 0; r < repeats; r++)
+			sink = fake::exclusive_scan(counts, 0u, pool);
+		const double scan = start.elapsed() / repeats;
+		std::cout << ' ' << threads << " thread" << (threads > 1 ? "s " : " ") << scan << "s ("
+			<< element_count * sizeof(unsigned int) / scan / 1e9 << " GB/s)";
+	}
+	std::cout << std::endl;
+}
+
+void scanBenchmark(){
+	for (std::size_t n : {std::size_t(1e6), std::size_t(1e7), std::size_t(1e8)})
+		scanFunction(n);
+}
+
+// view: filter, transform and take through temporary vectors against one lazy pipeline, counting allocations
+std::size_t allocation_count = 0;
+
+template <typename T>
+struct countingAllocator : std::allocator<T>{
+	template <typename U> struct rebind{typedef countingAllocator<U> other;};
+	countingAllocator() = default;
+	template <typename U> countingAllocator(const countingAllocator<U>&){}
+	T* allocate(std::size_t n){
+		allocation_count++;
+		return std::allocator<T>::allocate(n);
+	}
+};
+
+void viewFunction(unsigned int element_count){
+	typedef fake::vector<int, countingAllocator<int>> counted;
+	counted source;
+	for (unsigned int i = 0; i < element_count; i++)
+		source.push_back(i * 7919 % 1000);
+	const auto keep = [](int x){return x % 3 != 0;};
+	const auto square = [](int x){return x * x + 1;};
+	const std::size_t wanted = element_count / 2;
+	const int repeats = 1e8 / element_count + 1;
+
+	allocation_count = 0;
+	Timer start;
+	for (int r = 0; r < repeats; r++){
+		counted filtered;
+		for (int x : source)
+			if (keep(x))
+				filtered.push_back(x);
+		counted transformed;
+		transformed.reserve(filtered.size());
+		for (int x : filtered)
+			transformed.push_back(square(x));
+		counted taken(transformed.begin(), transformed.begin() + std::min(wanted, transformed.size()));
+		sink = taken.back();
+	}
+	const double materialized = start.elapsed() / repeats;
+	const double materialized_allocations = double(allocation_count) / repeats;
+
+	allocation_count = 0;
+	start.reset();
+	for (int r = 0; r < repeats; r++){
+		auto taken = source | fake::views::filter(keep) | fake::views::transform(square) | fake::views::take(wanted)
+			| fake::to<fake::vector>(countingAllocator<int>());
+		sink = taken.back();
+	}
+	const double lazy = start.elapsed() / repeats;
+	const double lazy_allocations = double(allocation_count) / repeats;
+
+	allocation_count = 0;
+	start.reset();
+	for (int r = 0; r < repeats; r++){
+		auto strided = source | fake::views::stride(2) | fake::views::transform(square) | fake::to<fake::vector>(countingAllocator<int>());
+		sink = strided.back();
+	}
+	const double sized = start.elapsed() / repeats;
+	const double sized_allocations = double(allocation_count) / repeats;
+
+	std::cout << element_count << " elements: filter|transform|take materialized " << materialized << "s "
+		<< materialized_allocations << " allocations, lazy " << lazy << "s " << lazy_allocations
+		<< " allocations; stride|transform lazy " << sized << "s " << sized_allocations << " allocations" << std::endl;
+}
+
+void viewBenchmark(){
+	for (unsigned int n : {1000u, 100000u, 10000000u})
+		viewFunction(n);
+}
+
+// blocks: scale, clamp and sum as three full passes against the same passes fused per cache-sized block
+template <typename Span>
+float threePasses(Span data){
+	for (float& x : data)
+		x = x * 0.5f + 1.f;
+	fake::simd::clamp(data.data(), data.data(), data.size(), -100.f, 100.f);
+	return fake::simd::sum(data.data(), data.size());
+}
+
+void blockFunction(std::size_t element_count){
+	fake::vector<float> data(element_count);
+	for (std::size_t i = 0; i < element_count; i++)
+		data[i] = float(i % 1000);
+	const int repeats = 1e9 / element_count + 1;
+	const fake::cache_info& cache = fake::detected_cache();
+
+	Timer start;
+	for (int r = 0; r < repeats; r++)
+		sink = threePasses(fake::span<float>(data.data(), data.size()));
+	std::cout << element_count << " floats: separate passes " << start.elapsed() / repeats << 's';
+
+	const std::size_t block_bytes[] = {cache.l1 / 2, cache.l2 / 2, cache.l2 * 2};
+	const char* names[] = {"L1/2", "L2/2", "2*L2"};
+	for (int b = 0; b < 3; b++){
+		start.reset();
+		for (int r = 0; r < repeats; r++){
+			float total = 0;
+			fake::for_each_block(data, block_bytes[b], [&](fake::span<float> block){total += threePasses(block);});
+			sink = total;
+		}
+		std::cout << ", " << names[b] << " blocks " << start.elapsed() / repeats << 's';
+	}
+	std::cout << std::endl;
+}
+
+void blockBenchmark(){
+	const fake::cache_info& cache = fake::detected_cache();
+	std::cout << "L1 " << cache.l1 << " L2 " << cache.l2 << " L3 " << cache.l3 << " bytes" << std::endl;
+	for (std::size_t n : {std::size_t(1e5), std::size_t(1e7), std::size_t(1e8)})
+		blockFunction(n);
+}
+
+// gather: out.push_back(table[idx[i]]) against fake::gather and fake::scatter at several prefetch distances
+void gatherFunction(std::size_t table_size, std::size_t index_count){
+	fake::vector<float> table(table_size);
+	for (std::size_t i = 0; i < table_size; i++)
+		table[i] = float(i);
+	fake::vector<unsigned int> indices;
+	indices.reserve(index_count);
+	unsigned long long x = 12345;
+	for (std::size_t i = 0; i < index_count; i++){
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+		indices.unchecked_push_back((x >> 16) % table_size);
+	}
+	fake::vector<float> out;
+	const int repeats = 2e8 / index_count + 1;
+	const auto perElement = [&](double seconds){return seconds / repeats / index_count * 1e9;};
+
+	Timer start;
+	for (int r = 0; r < repeats; r++){
+		out.clear();
+		for (std::size_t i = 0; i < index_count; i++)
+			out.push_back(table[indices[i]]);
+		sink = out.back();
+	}
+	std::cout << table_size * sizeof(float) / (1 << 20) << " MiB table, ns per element: push_back loop " << perElement(start.elapsed());
+
+	std::cout << ", gather distance";
+	for (std::size_t distance : {std::size_t(0), std::size_t(16), std::size_t(64), std::size_t(256)}){
+		start.reset();
+		for (int r = 0; r < repeats; r++){
+			fake::gather(table, indices, out, distance);
+			sink = out.back();
+		}
+		std::cout << ' ' << distance << ": " << perElement(start.elapsed());
+	}
+	start.reset();
+	for (int r = 0; r < repeats; r++){
+		fake::gather(table, indices, out);
+		sink = out.back();
+	}
+	std::cout << " default: " << perElement(start.elapsed());
+
+	start.reset();
+	for (int r = 0; r < repeats; r++)
+		for (std::size_t i = 0; i < index_count; i++)
+			table[indices[i]] = out[i];
+	std::cout << ", scatter loop " << perElement(start.elapsed());
+	start.reset();
+	for (int r = 0; r < repeats; r++)
+		fake::scatter(out, indices, table);
+	std::cout << " scatter " << perElement(start.elapsed()) << std::endl;
+}
+
+void gatherBenchmark(){
+	gatherFunction(std::size_t(1) << 18, std::size_t(1) << 22);
+	gatherFunction(std::size_t(1) << 22, std::size_t(1) << 22);
+	gatherFunction(std::size_t(1) << 28, std::size_t(1) << 24);
+}
+
+#if FAKE_HAS_CONSTEXPR_VECTOR
+// constexpr_table: 64Ki entry CRC-32 table (two bytes per step) built at startup against one frozen at compile time
+constexpr fake::vector<std::uint32_t> crcTable(){
+	fake::vector<std::uint32_t> bytes;
+	for (std::uint32_t i = 0; i < 256; i++){
+		std::uint32_t crc = i;
+		for (int bit = 0; bit < 8; bit++)
+			crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+		bytes.push_back(crc);
+	}
+	fake::vector<std::uint32_t> table;
+	table.reserve(1 << 16);
+	for (std::uint32_t i = 0; i < (1u << 16); i++){
+		const std::uint32_t crc = (i >> 8) ^ bytes[i & 0xFF];
+		table.push_back((crc >> 8) ^ bytes[crc & 0xFF]);
+	}
+	return table;
+}
+
+constexpr auto frozenCrcTable = fake::freeze([]{return crcTable();});
+
+void constexprTableBenchmark(){
+	Timer start;
+	const fake::vector<std::uint32_t> table = crcTable();
+	const double build = start.elapsed();
+	start.reset();
+	std::uint32_t sum = 0;
+	for (std::uint32_t entry : frozenCrcTable)
+		sum += entry;
+	const double touch = start.elapsed();
+	sink = sum;
+	const bool same = std::equal(table.begin(), table.end(), frozenCrcTable.begin());
+	std::cout << frozenCrcTable.size() << " entries, built at startup: " << build * 1e6 << "us, frozen at compile time: "
+		<< touch * 1e6 << "us to page in, tables " << (same ? "match" : "differ") << std::endl;
+}
+#else
+void constexprTableBenchmark(){
+	std::cout << "constexpr tables need C++20" << std::endl;
+}
+#endif
+
+// traits: each bulk element path against the per-element loop, forced by an allocator with its own construct and destroy
+template <typename T>
+struct loopAllocator : std::allocator<T>{
+	template <typename U> struct rebind{typedef loopAllocator<U> other;};
+	loopAllocator() = default;
+	template <typename U> loopAllocator(const loopAllocator<U>&){}
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args){::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);}
+	template <typename U>
+	void destroy(U* p){p->~U();}
+};
+
+// owning handle, marked trivially relocatable below
+template <bool Relocatable>
+struct handle{
+	int* value;
+	explicit handle(int v) : value(new int(v)) {}
+	handle(handle&& other) noexcept : value(other.value) {other.value = nullptr;}
+	handle& operator=(handle&& other) noexcept {std::swap(value, other.value); return *this;}
+	~handle(){delete value;}
+};
+
+namespace fake{
+	template <>
+	struct is_trivially_relocatable<handle<true>> : std::true_type {};
+}
+
+template <typename Vector>
+double zeroFillFunction(std::size_t element_count, int repeats){
+	Timer start;
+	for (int r = 0; r < repeats; r++){
+		Vector a(element_count);
+		sink = a[element_count / 2];
+	}
+	return start.elapsed() / repeats;
+}
+
+template <typename Vector>
+double relocateFunction(Vector& a, int repeats){
+	double total = 0;
+	for (int r = 0; r < repeats; r++){
+		a.shrink_to_fit();
+		Timer start;
+		a.reserve(2 * a.size());
+		total += start.elapsed();
+	}
+	return total / repeats;
+}
+
+template <typename Vector>
+double shiftFunction(Vector& a, int repeats){
+	a.reserve(a.size() + repeats);
+	Timer start;
+	for (int r = 0; r < repeats; r++)
+		a.emplace(a.begin(), r);
+	return start.elapsed() / repeats;
+}
+
+template <typename Vector>
+double destroyFunction(const Vector& source, int repeats){
+	double total = 0;
+	for (int r = 0; r < repeats; r++){
+		Vector a(source);
+		Timer start;
+		a.clear();
+		total += start.elapsed();
+	}
+	return total / repeats;
+}
+
+void traitsBenchmark(){
+	const std::size_t n = 1e7;
+	const auto report = [](const char* name, double loop, double bulk){
+		std::cout << name << ": loop " << loop * 1e3 << "ms, dispatched " << bulk * 1e3 << "ms" << std::endl;
+	};
+	report("value-initialize 1e7 int", zeroFillFunction<fake::vector<int, loopAllocator<int>>>(n, 10), zeroFillFunction<fake::vector<int>>(n, 10));
+
+	fake::vector<int, loopAllocator<int>> loop_ints(n, 1);
+	fake::vector<int> ints(n, 1);
+	report("relocate 1e7 int", relocateFunction(loop_ints, 10), relocateFunction(ints, 10));
+	report("insert at front of 1e7 int", shiftFunction(loop_ints, 10), shiftFunction(ints, 10));
+
+	fake::vector<handle<false>> handles;
+	fake::vector<handle<true>> relocatable_handles;
+	for (std::size_t i = 0; i < n / 10; i++){
+		handles.emplace_back(i);
+		relocatable_handles.emplace_back(i);
+	}
+	report("relocate 1e6 handles", relocateFunction(handles, 10), relocateFunction(relocatable_handles, 10));
+	report("insert at front of 1e6 handles", shiftFunction(handles, 10), shiftFunction(relocatable_handles, 10));
+
+	report("clear 1e7 int", destroyFunction(loop_ints, 10), destroyFunction(ints, 10));
+}
+
+// zeroed: value-initialized 2 GiB vector written zeros up front against one taken zeroed from calloc
+template <typename Vector>
+void zeroedFunction(const char* name, std::size_t element_count){
+	Timer start;
+	Vector a(element_count);
+	const double construct = start.elapsed();
+	start.reset();
+	for (std::size_t i = 0; i < element_count; i++)
+		a[i] += int(i);
+	const double first_pass = start.elapsed();
+	start.reset();
+	for (std::size_t i = 0; i < element_count; i++)
+		a[i] += int(i);
+	const double second_pass = start.elapsed();
+	sink = a[element_count / 2];
+	std::cout << name << ": construct " << construct * 1e3 << "ms, first pass " << first_pass * 1e3
+		<< "ms, second pass " << second_pass * 1e3 << "ms" << std::endl;
+}
+
+void zeroedBenchmark(){
+	const std::size_t element_count = std::size_t(1) << 29;
+	zeroedFunction<fake::vector<int>>("std::allocator", element_count);
+	zeroedFunction<fake::vector<int, fake::zeroed_allocator<int>>>("zeroed_allocator", element_count);
+}
+
+// lazy: 1% random writes to a huge table, fully constructed fake::vector against fake::lazy_vector
+std::size_t residentBytes(){
+	std::ifstream statm("/proc/self/statm");
+	std::size_t size = 0, resident = 0;
+	statm >> size >> resident;
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+struct record{
+	float values[64];
+	record(){std::fill(values, values + 64, 1.f);}
+};
+
+template <typename Table>
+void lazyFunction(const char* name, std::size_t element_count){
+	const std::size_t touches = element_count / 100;
+	const std::size_t resident = residentBytes();
+	Timer start;
+	Table table(element_count);
+	const double construct = start.elapsed();
+	start.reset();
+	unsigned long long x = 12345;
+	for (std::size_t i = 0; i < touches; i++){
+		x = x * 6364136223846793005ull + 1442695040888963407ull;
+		reinterpret_cast<float&>(table[(x >> 16) % element_count]) += 1.f;
+	}
+	const double touch = start.elapsed();
+	std::cout << name << ": construct " << construct * 1e3 << "ms, 1% writes " << touch * 1e3 << "ms, resident "
+		<< (residentBytes() - resident) / (1 << 20) << " MiB" << std::endl;
+}
+
+void lazyBenchmark(){
+	lazyFunction<fake::vector<record>>("1 GiB of 256 byte records, fake::vector", std::size_t(1) << 22);
+	lazyFunction<fake::lazy_vector<record>>("1 GiB of 256 byte records, fake::lazy_vector", std::size_t(1) << 22);
+	lazyFunction<fake::vector<float>>("1 GiB of float, fake::vector", std::size_t(1) << 28);
+	lazyFunction<fake::lazy_vector<float>>("1 GiB of float, fake::lazy_vector", std::size_t(1) << 28);
+}
+
+// vm: push_back throughput and worst batch of 4096 push_backs, fake::vector doubling against fake::vm_vector
+template <typename Vector>
+void vmFunction(const char* name, std::size_t element_count){
+	const std::size_t batch = 4096;
+	double worst = 0;
+	Timer total;
+	{
+		Vector a;
+		for (std::size_t i = 0; i < element_count; i += batch){
+			Timer start;
+			for (std::size_t j = i; j < i + batch; j++)
+				a.push_back(int(j));
+			worst = std::max(worst, start.elapsed());
+		}
+		sink = a.back();
+	}
+	const double seconds = total.elapsed();
+	std::cout << name << ": " << element_count / seconds / 1e6 << "M push_back/s, worst batch of " << batch << ": "
+		<< worst * 1e3 << "ms" << std::endl;
+}
+
+void vmBenchmark(){
+	const std::size_t element_count = std::size_t(1) << 28;
+	vmFunction<fake::vector<int>>("fake::vector", element_count);
+	vmFunction<fake::vm_vector<int>>("fake::vm_vector", element_count);
+}
+
+// release: RSS given back after a 1 GiB vector drops to 1% of its size, and by trim_all over idle vectors
+template <typename Vector, typename Release>
+void releaseFunction(const char* name, Release release){
+	const std::size_t element_count = std::size_t(1) << 28;
+	const std::size_t base = residentBytes();
+	Vector a(element_count, 1);
+	a.resize(element_count / 100);
+	const std::size_t before = residentBytes() - base;
+	Timer start;
+	release(a);
+	const double seconds = start.elapsed();
+	sink = a.back();
+	std::cout << name << ": " << before / (1 << 20) << " MiB -> " << (residentBytes() - base) / (1 << 20) << " MiB resident in "
+		<< seconds * 1e3 << "ms, capacity " << a.capacity() << std::endl;
+}
+
+void releaseBenchmark(){
+	typedef fake::vector<int> ints;
+	releaseFunction<ints>("shrink_to_fit", [](ints& a){a.shrink_to_fit();});
+	releaseFunction<ints>("release_unused", [](ints& a){a.release_unused();});
+	releaseFunction<ints>("release_unused(lazy)", [](ints& a){a.release_unused(true);});
+	typedef fake::vector<int, fake::shrinking_allocator<int>> shrinking;
+	releaseFunction<shrinking>("shrinking_allocator (already shrunk by resize)", [](shrinking&){});
+
+	const std::size_t base = residentBytes();
+	fake::vector<ints> idle;
+	for (int i = 0; i < 64; i++){
+		idle.emplace_back(std::size_t(1) << 21, 1);
+		idle.back().resize(1000);
+	}
+	fake::vector<std::unique_ptr<fake::trim_registration>> registrations;
+	for (ints& a : idle)
+		registrations.emplace_back(new fake::trim_registration(a));
+	const std::size_t before = residentBytes() - base;
+	Timer start;
+	const std::size_t trimmed = fake::trim_all();
+	const double seconds = start.elapsed();
+	std::cout << "trim_all over " << trimmed << " vectors at 1000 of 2M elements: " << before / (1 << 20) << " MiB -> "
+		<< (residentBytes() - base) / (1 << 20) << " MiB resident in " << seconds * 1e3 << "ms" << std::endl;
+}
+
+// budget: cost of charging a memory_budget, push_back into many short vectors (allocation bound) and a few long ones
+template <typename Vector, typename... Alloc>
+double budgetFunction(std::size_t vector_count, std::size_t element_count, const Alloc&... alloc){
+	Timer start;
+	for (std::size_t r = 0; r < vector_count; r++){
+		Vector a(alloc...);
+		for (std::size_t i = 0; i < element_count; i++)
+			a.push_back(int(i));
+		sink = a.back();
+	}
+	return start.elapsed();
+}
+
+void budgetBenchmark(){
+	typedef fake::vector<int, fake::budget_allocator<int>> budgeted;
+	const std::size_t shapes[][2] = {{1 << 20, 16}, {1 << 16, 1024}, {16, 1 << 22}};
+	for (const auto& shape : shapes){
+		fake::memory_budget batched("batched", std::size_t(1) << 32);
+		fake::memory_budget unbatched("unbatched", std::size_t(1) << 32, fake::memory_budget::exhaustion::raise, 0);
+		const double plain = budgetFunction<fake::vector<int>>(shape[0], shape[1]);
+		const double charged = budgetFunction<budgeted>(shape[0], shape[1], fake::budget_allocator<int>(batched));
+		const double exact = budgetFunction<budgeted>(shape[0], shape[1], fake::budget_allocator<int>(unbatched));
+		std::cout << shape[0] << " vectors of " << shape[1] << " push_backs: std::allocator " << plain << "s, budget "
+			<< charged << "s (" << (charged / plain - 1) * 100 << "%), unbatched budget " << exact << "s ("
+			<< (exact / plain - 1) * 100 << "%)" << std::endl;
+	}
+}
+
+// pregrow: worst single push_back while growing to 512 MiB, fake::vector against fake::pregrow_vector
+template <typename Vector>
+void pregrowFunction(const char* name, Vector a, std::size_t element_count){
+	typedef std::chrono::steady_clock clock;
+	clock::duration worst = clock::duration::zero();
+	Timer total;
+	for (std::size_t i = 0; i < element_count; i++){
+		const clock::time_point start = clock::now();
+		a.push_back(int(i));
+		worst = std::max(worst, clock::now() - start);
+	}
+	const double seconds = total.elapsed();
+	sink = static_cast<const Vector&>(a)[element_count - 1];
+	std::cout << name << ": " << seconds << "s, worst push_back "
+		<< std::chrono::duration<double, std::milli>(worst).count() << "ms" << std::endl;
+}
+
+void pregrowBenchmark(){
+	const std::size_t element_count = std::size_t(1) << 27;
+	pregrowFunction("fake::vector", fake::vector<int>(), element_count);
+	pregrowFunction("fake::pregrow_vector", fake::pregrow_vector<int>(), element_count);
+	pregrowFunction("fake::pregrow_vector, watermark 0.25", fake::pregrow_vector<int>(0.25f), element_count);
+}
+
+// incremental: push_back latency percentiles while growing to 512 MiB, from a histogram with 1ns buckets
+template <typename Vector>
+void incrementalFunction(const char* name, Vector a, std::size_t element_count){
+	typedef std::chrono::steady_clock clock;
+	fake::vector<std::size_t> histogram(1 << 16);
+	clock::duration worst = clock::duration::zero();
+	Timer total;
+	for (std::size_t i = 0; i < element_count; i++){
+		const clock::time_point start = clock::now();
+		a.push_back(int(i));
+		const clock::duration latency = clock::now() - start;
+		worst = std::max(worst, latency);
+		const std::size_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+		histogram[std::min<std::size_t>(ns, histogram.size() - 1)]++;
+	}
+	const double seconds = total.elapsed();
+	sink = static_cast<const Vector&>(a)[element_count / 2];
+	std::size_t p999 = 0;
+	for (std::size_t count = 0; count < element_count - element_count / 1000; p999++)
+		count += histogram[p999];
+	std::cout << name << ": " << seconds << "s, p99.9 push_back " << p999 - 1 << "ns, worst "
+		<< std::chrono::duration<double, std::milli>(worst).count() << "ms" << std::endl;
+}
+
+void incrementalBenchmark(){
+	const std::size_t element_count = std::size_t(1) << 27;
+	incrementalFunction("fake::vector", fake::vector<int>(), element_count);
+	incrementalFunction("fake::pregrow_vector", fake::pregrow_vector<int>(), element_count);
+	incrementalFunction("fake::incremental_vector", fake::incremental_vector<int>(), element_count);
+}
+
+void pushBackBenchmark(){
 	const int operation_count = 1e7;
-	const int test_count = 1;
+	const int test_count = 100;
 	double fake = 0;
 	double real = 0;
 	for (int i = 0; i < test_count; i++){
-		fake += testFunction<fake::vector<int>>(operation_count);
-		real += testFunction<std::vector<int>>(operation_count);
+		fake += testFunction<fake::vector<std::string>>(operation_count);
+		real += testFunction<std::vector<std::string>>(operation_count);
 	}
 
 	std::cout << "Average fake time: " << fake/test_count << 's' << std::endl;
 	std::cout << "Average real time: " << real/test_count << 's' << std::endl;
 	std::cout << (1-fake/real)*100 << "\% performance increase" << std::endl;
+}
+
+int main(int argc, char* argv[]){
+	const std::string benchmark = argc > 1 ? argv[1] : "push_back";
+	if (benchmark == "append")
+		appendBenchmark();
+	else if (benchmark == "unchecked")
+		uncheckedBenchmark();
+	else if (benchmark == "nested")
+		nestedBenchmark();
+	else if (benchmark == "hot_path")
+		hotPathBenchmark();
+	else if (benchmark == "erase_if")
+		eraseIfBenchmark();
+	else if (benchmark == "erase_indices")
+		eraseIndicesBenchmark();
+	else if (benchmark == "insert_batch")
+		insertBatchBenchmark();
+	else if (benchmark == "search")
+		searchBenchmark();
+	else if (benchmark == "radix_sort")
+		sortBenchmark();
+	else if (benchmark == "expression")
+		expressionBenchmark();
+	else if (benchmark == "kernels")
+		kernelBenchmark();
+	else if (benchmark == "scan")
+		scanBenchmark();
+	else if (benchmark == "view")
+		viewBenchmark();
+	else if (benchmark == "blocks")
+		blockBenchmark();
+	else if (benchmark == "gather")
+		gatherBenchmark();
+	else if (benchmark == "constexpr_table")
+		constexprTableBenchmark();
+	else if (benchmark == "traits")
+		traitsBenchmark();
+	else if (benchmark == "zeroed")
+		zeroedBenchmark();
+	else if (benchmark == "lazy")
+		lazyBenchmark();
+	else if (benchmark == "vm")
+		vmBenchmark();
+	else if (benchmark == "release")
+		releaseBenchmark();
+	else if (benchmark == "budget")
+		budgetBenchmark();
+	else if (benchmark == "pregrow")
+		pregrowBenchmark();
+	else if (benchmark == "incremental")
+		incrementalBenchmark();
+	else
+		pushBackBenchmark();
 	
  	return 0;
-}
\ No newline at end of file
+}